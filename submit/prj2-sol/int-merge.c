@@ -0,0 +1,363 @@
+#include "int-merge.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/** Return index of first of v[lo, n) which is >= x; n if none.  Probes
+ *  v[lo], v[lo + 1], v[lo + 3], v[lo + 7], ... before binary search,
+ *  so the cost is logarithmic in the distance moved rather than in n.
+ */
+static int
+gallop(const int v[], int lo, int n, int x)
+{
+  if (lo >= n || v[lo] >= x) return lo;
+  int step = 1;
+  int hi = lo + 1;
+  while (hi < n && v[hi] < x) {
+    lo = hi;
+    step *= 2;
+    hi = lo + step;
+  }
+  if (hi > n) hi = n;
+  //v[lo] < x; v[hi] >= x if hi < n
+  lo++;
+  while (lo < hi) {
+    int mid = lo + (hi - lo)/2;
+    if (v[mid] < x) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+int
+mergeIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                         int out[])
+{
+  int i = 0, j = 0, k = 0;
+  while (i < nA && j < nB) {
+    int x = a[i], y = b[j];
+    if (x == y) out[k++] = x;
+    i += x <= y;
+    j += y <= x;
+  }
+  return k;
+}
+
+int
+gallopIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                          int out[])
+{
+  //search the larger input for each element of the smaller one
+  const int *small = a, *large = b;
+  int nSmall = nA, nLarge = nB;
+  if (nA > nB) {
+    small = b; large = a;
+    nSmall = nB; nLarge = nA;
+  }
+  int p = 0, k = 0;
+  for (int i = 0; i < nSmall; i++) {
+    int x = small[i];
+    p = gallop(large, p, nLarge, x);
+    if (p == nLarge) break;
+    if (large[p] == x) out[k++] = x;
+  }
+  return k;
+}
+
+#if defined(__AVX2__)
+
+/** Intersect 8-element blocks: each block of a is compared against all
+ *  8 rotations of the current block of b, and the block with the
+ *  smaller maximum is then advanced (both if the maxima are equal).
+ */
+int
+simdIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                        int out[])
+{
+  const __m256i rotations[8] = {
+    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+    _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0),
+    _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1),
+    _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2),
+    _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3),
+    _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4),
+    _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5),
+    _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6),
+  };
+  int i = 0, j = 0, k = 0;
+  while (i + 8 <= nA && j + 8 <= nB) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+    __m256i vb = _mm256_loadu_si256((const __m256i *)&b[j]);
+    __m256i eq = _mm256_cmpeq_epi32(va, vb);
+    for (int r = 1; r < 8; r++) {
+      __m256i rotated = _mm256_permutevar8x32_epi32(vb, rotations[r]);
+      eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, rotated));
+    }
+    unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+    //read the block before writing, since out may alias a or b
+    int block[8];
+    _mm256_storeu_si256((__m256i *)block, va);
+    int aMax = block[7], bMax = b[j + 7];
+    for (; mask != 0; mask &= mask - 1) out[k++] = block[__builtin_ctz(mask)];
+    i += (aMax <= bMax) * 8;
+    j += (bMax <= aMax) * 8;
+  }
+  return k + mergeIntersectSortedInts(&a[i], nA - i, &b[j], nB - j, &out[k]);
+}
+
+#elif defined(__SSE2__)
+
+/** Intersect 4-element blocks: each block of a is compared against all
+ *  4 rotations of the current block of b, and the block with the
+ *  smaller maximum is then advanced (both if the maxima are equal).
+ */
+int
+simdIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                        int out[])
+{
+  int i = 0, j = 0, k = 0;
+  while (i + 4 <= nA && j + 4 <= nB) {
+    __m128i va = _mm_loadu_si128((const __m128i *)&a[i]);
+    __m128i vb = _mm_loadu_si128((const __m128i *)&b[j]);
+    __m128i eq0 = _mm_cmpeq_epi32(va, vb);
+    __m128i eq1 =
+      _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+    __m128i eq2 =
+      _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128i eq3 =
+      _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+    __m128i eq = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+    unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    //read the block before writing, since out may alias a or b
+    int block[4];
+    _mm_storeu_si128((__m128i *)block, va);
+    int aMax = block[3], bMax = b[j + 3];
+    for (; mask != 0; mask &= mask - 1) out[k++] = block[__builtin_ctz(mask)];
+    i += (aMax <= bMax) * 4;
+    j += (bMax <= aMax) * 4;
+  }
+  return k + mergeIntersectSortedInts(&a[i], nA - i, &b[j], nB - j, &out[k]);
+}
+
+#else
+
+int
+simdIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                        int out[])
+{
+  return mergeIntersectSortedInts(a, nA, b, nB, out);
+}
+
+#endif
+
+/** Copy in[n] to out[] and return n; in may be NULL when n is 0 */
+static int
+copyInts(int out[], const int in[], int n)
+{
+  if (n > 0) memcpy(out, in, n * sizeof(int));
+  return n;
+}
+
+/** Return non-zero iff one of n1, n2 is at least ratio times the other */
+static int
+isSkewed(int n1, int n2, int ratio)
+{
+  return (long)n1 >= (long)ratio * n2 || (long)n2 >= (long)ratio * n1;
+}
+
+int
+intersectSortedInts(const int a[], int nA, const int b[], int nB, int out[])
+{
+  if (nA == 0 || nB == 0) return 0;
+  if (isSkewed(nA, nB, INTERSECT_GALLOP_RATIO)) {
+    return gallopIntersectSortedInts(a, nA, b, nB, out);
+  }
+  return simdIntersectSortedInts(a, nA, b, nB, out);
+}
+
+int
+mergeUnionSortedInts(const int a[], int nA, const int b[], int nB, int out[])
+{
+  int i = 0, j = 0, k = 0;
+  while (i < nA && j < nB) {
+    int x = a[i], y = b[j];
+    out[k++] = x <= y ? x : y;
+    i += x <= y;
+    j += y <= x;
+  }
+  k += copyInts(&out[k], &a[i], nA - i);
+  return k + copyInts(&out[k], &b[j], nB - j);
+}
+
+int
+gallopUnionSortedInts(const int a[], int nA, const int b[], int nB, int out[])
+{
+  const int *small = a, *large = b;
+  int nSmall = nA, nLarge = nB;
+  if (nA > nB) {
+    small = b; large = a;
+    nSmall = nB; nLarge = nA;
+  }
+  int p = 0, k = 0;
+  for (int i = 0; i < nSmall; i++) {
+    int x = small[i];
+    int q = gallop(large, p, nLarge, x);
+    k += copyInts(&out[k], &large[p], q - p);
+    out[k++] = x;
+    p = q + (q < nLarge && large[q] == x);
+  }
+  return k + copyInts(&out[k], &large[p], nLarge - p);
+}
+
+int
+unionSortedInts(const int a[], int nA, const int b[], int nB, int out[])
+{
+  if (isSkewed(nA, nB, UNION_GALLOP_RATIO)) {
+    return gallopUnionSortedInts(a, nA, b, nB, out);
+  }
+  return mergeUnionSortedInts(a, nA, b, nB, out);
+}
+
+int
+differenceSortedInts(const int a[], int nA, const int b[], int nB, int out[])
+{
+  int i = 0, j = 0, k = 0;
+  if (isSkewed(nA, nB, INTERSECT_GALLOP_RATIO) && nB > nA) {
+    for (i = 0; i < nA; i++) {
+      j = gallop(b, j, nB, a[i]);
+      if (j == nB || b[j] != a[i]) out[k++] = a[i];
+    }
+    return k;
+  }
+  while (i < nA && j < nB) {
+    int x = a[i], y = b[j];
+    if (x < y) out[k++] = x;
+    i += x <= y;
+    j += y <= x;
+  }
+  //copy rather than memcpy, since out may be a
+  while (i < nA) out[k++] = a[i++];
+  return k;
+}
+
+int
+symDiffSortedInts(const int a[], int nA, const int b[], int nB, int out[])
+{
+  int i = 0, j = 0, k = 0;
+  while (i < nA && j < nB) {
+    int x = a[i], y = b[j];
+    if (x != y) out[k++] = x < y ? x : y;
+    i += x <= y;
+    j += y <= x;
+  }
+  k += copyInts(&out[k], &a[i], nA - i);
+  return k + copyInts(&out[k], &b[j], nB - j);
+}
+
+/** Cursor into one input of a k-way operation */
+typedef struct {
+  const int *elements;
+  int n;
+  int index;  /** position of current element */
+} Cursor;
+
+static int
+cursorSizeCompare(const void *p1, const void *p2)
+{
+  int n1 = ((const Cursor *)p1)->n, n2 = ((const Cursor *)p2)->n;
+  return (n1 > n2) - (n1 < n2);
+}
+
+int
+intersectManySortedInts(const int *arrays[], const int sizes[], int k,
+                        int out[])
+{
+  if (k == 1) return copyInts(out, arrays[0], sizes[0]);
+  if (k == 2) return intersectSortedInts(arrays[0], sizes[0],
+                                         arrays[1], sizes[1], out);
+  Cursor *cursors = malloc(k * sizeof(Cursor));
+  if (!cursors) return -1;
+  for (int i = 0; i < k; i++) {
+    cursors[i] = (Cursor) { .elements = arrays[i], .n = sizes[i] };
+  }
+  //probing the smallest arrays first rejects candidates soonest
+  qsort(cursors, k, sizeof(Cursor), cursorSizeCompare);
+  const Cursor *smallest = &cursors[0];
+  int nOut = 0;
+  int i = 0;
+  while (i < smallest->n) {
+    int x = smallest->elements[i];
+    int next = x;  //smallest value which may still be in every array
+    for (int j = 1; j < k && next == x; j++) {
+      Cursor *c = &cursors[j];
+      c->index = gallop(c->elements, c->index, c->n, x);
+      if (c->index == c->n) {
+        free(cursors);
+        return nOut;
+      }
+      next = c->elements[c->index];
+    }
+    if (next == x) {
+      out[nOut++] = x;
+      i++;
+    }
+    else {
+      i = gallop(smallest->elements, i + 1, smallest->n, next);
+    }
+  }
+  free(cursors);
+  return nOut;
+}
+
+/** Restore the min-heap order (keyed by current element) of heap[n]
+ *  below heap[i], whose subtrees must already be heaps.
+ */
+static void
+siftDown(Cursor heap[], int n, int i)
+{
+  Cursor top = heap[i];
+  int x = top.elements[top.index];
+  for (;;) {
+    int child = 2*i + 1;
+    if (child >= n) break;
+    if (child + 1 < n &&
+        heap[child + 1].elements[heap[child + 1].index] <
+        heap[child].elements[heap[child].index]) {
+      child++;
+    }
+    if (heap[child].elements[heap[child].index] >= x) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = top;
+}
+
+int
+unionManySortedInts(const int *arrays[], const int sizes[], int k, int out[])
+{
+  if (k == 1) return copyInts(out, arrays[0], sizes[0]);
+  if (k == 2) return unionSortedInts(arrays[0], sizes[0],
+                                     arrays[1], sizes[1], out);
+  Cursor *heap = malloc(k * sizeof(Cursor));
+  if (!heap) return -1;
+  int nHeap = 0;
+  for (int i = 0; i < k; i++) {
+    if (sizes[i] > 0) {
+      heap[nHeap++] = (Cursor) { .elements = arrays[i], .n = sizes[i] };
+    }
+  }
+  for (int i = nHeap/2 - 1; i >= 0; i--) siftDown(heap, nHeap, i);
+  int nOut = 0;
+  while (nHeap > 0) {
+    Cursor *top = &heap[0];
+    int x = top->elements[top->index];
+    if (nOut == 0 || out[nOut - 1] != x) out[nOut++] = x;
+    if (++top->index == top->n) heap[0] = heap[--nHeap];
+    if (nHeap > 0) siftDown(heap, nHeap, 0);
+  }
+  free(heap);
+  return nOut;
+}
@@ -0,0 +1,87 @@
+#ifndef INT_MERGE_H_
+#define INT_MERGE_H_
+
+/** Set-algebra kernels on strictly increasing int arrays.  Each
+ *  writes its result, also strictly increasing, to out[] and returns
+ *  the # of elements written.
+ */
+
+/** When one input is at least this many times larger than the other,
+ *  intersectSortedInts() and unionSortedInts() gallop through the
+ *  larger input instead of merging.  Crossover points are from
+ *  merge-bench on 10**6-element inputs.
+ */
+enum { INTERSECT_GALLOP_RATIO = 32, UNION_GALLOP_RATIO = 8 };
+
+/** Set out[] to the intersection of a[nA] and b[nB], choosing between
+ *  the kernels below by the relative sizes of a and b.  out[] must
+ *  have room for min(nA, nB) elements; it may be a or b.
+ */
+int intersectSortedInts(const int a[], int nA, const int b[], int nB,
+                        int out[]);
+
+/** intersectSortedInts() by a plain two-finger merge. */
+int mergeIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                             int out[]);
+
+/** intersectSortedInts() by exponential search of the larger input
+ *  for each element of the smaller: O(m log(n/m)) for sizes m <= n.
+ */
+int gallopIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                              int out[]);
+
+/** intersectSortedInts() comparing blocks of a against blocks of b
+ *  with SIMD all-pairs compares (8 ints wide with AVX2, else 4 with
+ *  SSE2); falls back to mergeIntersectSortedInts() without SIMD.
+ */
+int simdIntersectSortedInts(const int a[], int nA, const int b[], int nB,
+                            int out[]);
+
+/** Set out[] to the union of a[nA] and b[nB], galloping through the
+ *  larger input when the sizes are very unequal.  out[] must have
+ *  room for nA + nB elements and must not overlap a or b.
+ */
+int unionSortedInts(const int a[], int nA, const int b[], int nB, int out[]);
+
+/** unionSortedInts() by a branch-free two-finger merge. */
+int mergeUnionSortedInts(const int a[], int nA, const int b[], int nB,
+                         int out[]);
+
+/** unionSortedInts() copying the stretches of the larger input between
+ *  elements of the smaller, found by exponential search.
+ */
+int gallopUnionSortedInts(const int a[], int nA, const int b[], int nB,
+                          int out[]);
+
+/** Set out[] to the elements of a[nA] which are not in b[nB],
+ *  galloping through b when it is much larger than a.  out[] must
+ *  have room for nA elements; it may be a.
+ */
+int differenceSortedInts(const int a[], int nA, const int b[], int nB,
+                         int out[]);
+
+/** Set out[] to the elements in exactly one of a[nA] and b[nB].  out[]
+ *  must have room for nA + nB elements and must not overlap a or b.
+ */
+int symDiffSortedInts(const int a[], int nA, const int b[], int nB, int out[]);
+
+/** Set out[] to the intersection of the k arrays arrays[i][sizes[i]],
+ *  for 0 <= i < k.  Candidates are taken from the smallest array and
+ *  looked up in the others, smallest first, by exponential search; a
+ *  miss skips the candidates up to the value found.  out[] must have
+ *  room for the smallest size and must not overlap any input.
+ *  Returns < 0 with errno set if scratch space cannot be allocated.
+ */
+int intersectManySortedInts(const int *arrays[], const int sizes[], int k,
+                            int out[]);
+
+/** Set out[] to the union of the k arrays arrays[i][sizes[i]], for
+ *  0 <= i < k, by a k-way merge using a binary heap of array heads.
+ *  out[] must have room for the sum of the sizes and must not overlap
+ *  any input.  Returns < 0 with errno set if scratch space cannot be
+ *  allocated.
+ */
+int unionManySortedInts(const int *arrays[], const int sizes[], int k,
+                        int out[]);
+
+#endif //ifndef INT_MERGE_H_
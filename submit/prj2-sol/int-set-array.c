@@ -0,0 +1,158 @@
+#include "int-set-array.h"
+#include "int-merge.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Minimum # of elements allocated for a non-empty array */
+enum { MIN_ARRAY_CAPACITY = 16 };
+
+/** Ensure header->array can hold at least n elements, growing its
+ *  capacity geometrically so that a series of appends is amortized
+ *  O(1) per element.  Returns 0 on success, < 0 on error with errno set.
+ */
+static int ensureArrayCapacity(Header *header, int n) {
+    ArrayRep *array = &header->array;
+    if (n <= array->capacity) return 0;
+    int capacity = array->capacity < MIN_ARRAY_CAPACITY
+        ? MIN_ARRAY_CAPACITY : array->capacity;
+    while (capacity < n) capacity *= 2;
+    int *elements = realloc(array->elements, capacity * sizeof(int));
+    if (!elements) return -1;
+    array->elements = elements;
+    array->capacity = capacity;
+    return 0;
+}
+
+/** Return index of first element in elements[n] which is >= value;
+ *  n if there is no such element.
+ */
+static int lowerBound(const int elements[], int n, int value) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (elements[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/** Return non-zero iff header contains element, using binary search. */
+int isInArrayIntSet(const Header *header, int element) {
+    const ArrayRep *array = &header->array;
+    int i = lowerBound(array->elements, header->nElements, element);
+    return i < header->nElements && array->elements[i] == element;
+}
+
+/** Return # of elements of header which are < element. */
+int rankArrayIntSet(const Header *header, int element) {
+    return lowerBound(header->array.elements, header->nElements, element);
+}
+
+/** Add element to header.  Returns # of elements after addition,
+ *  < 0 on error with errno set.
+ */
+int addArrayIntSet(Header *header, int element) {
+    int n = header->nElements;
+    int i = lowerBound(header->array.elements, n, element);
+    if (i < n && header->array.elements[i] == element) return n;
+    if (ensureArrayCapacity(header, n + 1) < 0) return -1;
+    int *elements = header->array.elements;
+    memmove(&elements[i + 1], &elements[i], (n - i) * sizeof(int));
+    elements[i] = element;
+    return ++header->nElements;
+}
+
+/** Merge sorted[n], which must be strictly increasing, into header.
+ *  Returns # of elements after addition, < 0 on error with errno set.
+ */
+int addSortedArrayIntSet(Header *header, const int sorted[], int n) {
+    int nA = header->nElements;
+    if (ensureArrayCapacity(header, nA + n) < 0) return -1;
+    int *elements = header->array.elements;
+    //merge from the back so that no element of A is overwritten
+    //before it is read
+    int iA = nA - 1, iB = n - 1, k = nA + n;
+    while (iB >= 0) {
+        if (iA >= 0 && elements[iA] > sorted[iB]) {
+            elements[--k] = elements[iA--];
+        }
+        else {
+            if (iA >= 0 && elements[iA] == sorted[iB]) iA--;
+            elements[--k] = sorted[iB--];
+        }
+    }
+    //each duplicate left a one-element gap before the merged elements
+    if (k > iA + 1) {
+        memmove(&elements[iA + 1], &elements[k], (nA + n - k) * sizeof(int));
+    }
+    return header->nElements = iA + 1 + nA + n - k;
+}
+
+/** Set header to its union with intSetB (of any representation).
+ *  Returns # of elements after union, < 0 on error with errno set.
+ */
+int unionArrayIntSet(Header *header, const void *intSetB) {
+    int nB = nElementsIntSet((void *)intSetB);
+    if (nB == 0) return header->nElements;
+    int nA = header->nElements;
+    int *merged = malloc((nA + nB) * sizeof(int));
+    if (!merged) return -1;
+    const int *elementsA = header->array.elements;
+    const Header *headerB = (const Header *)intSetB;
+    if (headerB->backend == ARRAY_INT_SET) {
+        int n = unionSortedInts(elementsA, nA, headerB->array.elements, nB,
+                                merged);
+        free(header->array.elements);
+        header->array.elements = merged;
+        header->array.capacity = nA + nB;
+        return header->nElements = n;
+    }
+    const void *iter = newIntSetIterator(intSetB);
+    if (!iter) { //B is not empty, so iteration could not be started
+        free(merged);
+        return -1;
+    }
+    int iA = 0, n = 0;
+    for (; iter != NULL; iter = stepIntSetIterator(iter)) {
+        int b = intSetIteratorElement(iter);
+        while (iA < nA && elementsA[iA] < b) merged[n++] = elementsA[iA++];
+        if (iA < nA && elementsA[iA] == b) iA++;
+        merged[n++] = b;
+    }
+    while (iA < nA) merged[n++] = elementsA[iA++];
+    free(header->array.elements);
+    header->array.elements = merged;
+    header->array.capacity = nA + nB;
+    return header->nElements = n;
+}
+
+/** Set header to its intersection with intSetB (of any
+ *  representation).  Returns # of elements after intersection, < 0
+ *  on error with errno set.
+ */
+int intersectionArrayIntSet(Header *header, const void *intSetB) {
+    int *elements = header->array.elements;
+    int nA = header->nElements;
+    const Header *headerB = (const Header *)intSetB;
+    if (headerB->backend == ARRAY_INT_SET) {
+        return header->nElements =
+            intersectSortedInts(elements, nA, headerB->array.elements,
+                                headerB->nElements, elements);
+    }
+    const void *iter = newIntSetIterator(intSetB);
+    //NULL for an empty B, but also if iteration could not be started
+    if (!iter && headerB->nElements > 0) return -1;
+    int iA = 0, n = 0;
+    for (; iter != NULL && iA < nA; iter = stepIntSetIterator(iter)) {
+        int b = intSetIteratorElement(iter);
+        while (iA < nA && elements[iA] < b) iA++;
+        if (iA < nA && elements[iA] == b) elements[n++] = elements[iA++];
+    }
+    freeIntSetIterator(iter);
+    return header->nElements = n;
+}
+
+/** Free the elements of header (but not header itself). */
+void freeArrayIntSet(Header *header) {
+    free(header->array.elements);
+}
@@ -0,0 +1,41 @@
+#ifndef INT_SET_ARRAY_H_
+#define INT_SET_ARRAY_H_
+
+#include "int-set.h"
+
+/** Sorted-array representation for int-sets (ARRAY_INT_SET).  These
+ *  routines are called by the int-set.c entry points after dispatching
+ *  on header->backend; they all require header->backend == ARRAY_INT_SET.
+ */
+
+/** Return non-zero iff header contains element, using binary search. */
+int isInArrayIntSet(const Header *header, int element);
+
+/** Return # of elements of header which are < element. */
+int rankArrayIntSet(const Header *header, int element);
+
+/** Add element to header.  Returns # of elements after addition,
+ *  < 0 on error with errno set.
+ */
+int addArrayIntSet(Header *header, int element);
+
+/** Merge sorted[n], which must be strictly increasing, into header.
+ *  Returns # of elements after addition, < 0 on error with errno set.
+ */
+int addSortedArrayIntSet(Header *header, const int sorted[], int n);
+
+/** Set header to its union with intSetB (of any representation).
+ *  Returns # of elements after union, < 0 on error with errno set.
+ */
+int unionArrayIntSet(Header *header, const void *intSetB);
+
+/** Set header to its intersection with intSetB (of any
+ *  representation).  Returns # of elements after intersection, < 0
+ *  on error with errno set.
+ */
+int intersectionArrayIntSet(Header *header, const void *intSetB);
+
+/** Free the elements of header (but not header itself). */
+void freeArrayIntSet(Header *header);
+
+#endif //ifndef INT_SET_ARRAY_H_
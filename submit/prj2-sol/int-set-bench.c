@@ -0,0 +1,284 @@
+#define _POSIX_C_SOURCE 200809L  //for clock_gettime() under -std=c18
+
+#include "int-set.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/** Benchmark for the int-set backends.  For each backend, distribution
+ *  of elements and set size from 10 up to 10**MAX_EXP it times adding
+ *  elements one at a time, lookups (half hits), iteration, and
+ *  unionIntSet() and intersectionIntSet() against a second set of the
+ *  same size and distribution, and measures the heap footprint of the
+ *  set built by the adds.
+ */
+
+static void
+usage(const char *program, const char *msg)
+{
+  fprintf(stderr, "%susage: %s [-m MAX_EXP] [-l LIST_MAX] [-r N_REPS] "
+          "[-s seed] [-o CSV_FILE]\n"
+          "  -m: largest set size is 10**MAX_EXP (default %d)\n"
+          "  -l: largest set size for O(n) inserts: the list backend, "
+          "and adds\n      to the array backend (default %d)\n"
+          "  -r: # of timed repetitions per measurement (default %d)\n"
+          "  -s: seed for element generation (default 0)\n"
+          "  -o: write machine-readable CSV results to CSV_FILE\n",
+          msg, program, 6, 10000, 3);
+  exit(1);
+}
+
+static const char *BACKEND_NAMES[N_INT_SET_BACKENDS] = {
+  [LIST_INT_SET] = "list",
+  [ARRAY_INT_SET] = "array",
+  [BITMAP_INT_SET] = "bitmap",
+  [HASH_INT_SET] = "hash",
+};
+
+typedef enum {
+  UNIFORM,   //uniform over all ints
+  CLUSTERED, //runs of CLUSTER consecutive values at uniform starts
+  SKEWED,    //power-law concentrated towards 0; many repeats
+  N_DISTRIBUTIONS
+} Distribution;
+
+static const char *DISTRIBUTION_NAMES[N_DISTRIBUTIONS] = {
+  "uniform", "clustered", "skewed"
+};
+
+enum { CLUSTER = 64 };
+
+/** Simple xorshift64* generator so that sets do not depend on rand() */
+static unsigned long
+next_random(unsigned long *state)
+{
+  unsigned long x = *state;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DUL;
+}
+
+/** Fill v[n] with elements drawn from distribution, in random order. */
+static void
+make_elements(int v[], int n, Distribution distribution, unsigned long *state)
+{
+  int base = 0;
+  for (int i = 0; i < n; i++) {
+    unsigned long r = next_random(state);
+    switch (distribution) {
+    case UNIFORM:
+      v[i] = (int)(unsigned)(r >> 32);
+      break;
+    case CLUSTERED:
+      if (i % CLUSTER == 0) base = (int)(unsigned)(r >> 32);
+      v[i] = (int)((unsigned)base + i % CLUSTER);
+      break;
+    default: {
+      //u**4 for uniform u piles values up near 0 over a span of 16n
+      double u = (r >> 11) * 0x1.0p-53;
+      v[i] = (int)(16.0 * n * pow(u, 4));
+    }
+    }
+  }
+  //clusters are generated in order; shuffle so that adds are random
+  for (int i = n - 1; i > 0; i--) {
+    int j = next_random(state) % (i + 1);
+    int t = v[i]; v[i] = v[j]; v[j] = t;
+  }
+}
+
+static double
+elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+static int
+double_compare(const void *p1, const void *p2)
+{
+  double d1 = *(const double *)p1;
+  double d2 = *(const double *)p2;
+  return (d1 > d2) - (d1 < d2);
+}
+
+/** Return # of bytes of heap in use; -1 if unknown.  glibc counts
+ *  chunks parked in its per-thread cache as in use, so run with
+ *  GLIBC_TUNABLES=glibc.malloc.tcache_count=0 (as make set-bench does)
+ *  for exact footprints of small sets.
+ */
+static long
+heap_in_use(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd; //large blocks are mmap()ed apart
+#else
+  return -1;
+#endif
+}
+
+typedef enum { ADD, LOOKUP, ITERATE, UNION, INTERSECTION, N_OPS } Op;
+
+static const char *OP_NAMES[N_OPS] = {
+  "add", "lookup", "iterate", "union", "intersection"
+};
+
+/** Return a new set using backend holding elements[n] */
+static void *
+new_set(IntSetBackend backend, const int elements[], int n)
+{
+  void *set = newBackendIntSet(backend);
+  if (!set || addMultipleIntSet(set, elements, n) < 0) {
+    perror("building set");
+    exit(1);
+  }
+  return set;
+}
+
+/** Return ns taken by one run of op on backend sets of a[n] and b[n].
+ *  Only the operation itself is timed.  For ADD, sets *bytes to the
+ *  heap footprint of the resulting set.
+ */
+static double
+time_op(Op op, IntSetBackend backend, const int a[], const int b[], int n,
+        long *bytes)
+{
+  struct timespec t0, t1;
+  long heap0 = heap_in_use();
+  void *set = (op == ADD) ? newBackendIntSet(backend) : new_set(backend, a, n);
+  void *other = (op == UNION || op == INTERSECTION) ? new_set(backend, b, n)
+    : NULL;
+  volatile long sink = 0; //keeps lookups and iteration from being elided
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  switch (op) {
+  case ADD:
+    for (int i = 0; i < n; i++) addIntSet(set, a[i]);
+    break;
+  case LOOKUP:
+    for (int i = 0; i < n; i++) sink += isInIntSet(set, (i & 1) ? a[i] : b[i]);
+    break;
+  case ITERATE:
+    for (const void *iter = newIntSetIterator(set); iter != NULL;
+         iter = stepIntSetIterator(iter)) {
+      sink += intSetIteratorElement(iter);
+    }
+    break;
+  case UNION:
+    unionIntSet(set, other);
+    break;
+  default:
+    intersectionIntSet(set, other);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  if (op == ADD && heap0 >= 0) *bytes = heap_in_use() - heap0;
+  freeIntSet(set);
+  if (other) freeIntSet(other);
+  return elapsed_ns(&t0, &t1);
+}
+
+int
+main(int argc, const char *argv[])
+{
+  const char *program = argv[0];
+  int maxExp = 6;
+  int listMax = 10000;
+  int nReps = 3;
+  unsigned long seed = 0;
+  const char *csvPath = NULL;
+  for (int i = 1; i < argc; i++) {
+    const char *opt = argv[i];
+    if (opt[0] != '-' || strlen(opt) != 2 || strchr("mlrso", opt[1]) == NULL) {
+      usage(program, "invalid option\n");
+    }
+    if (i >= argc - 1) usage(program, "option requires additional argument\n");
+    const char *arg = argv[++i];
+    if (opt[1] == 'o') {
+      csvPath = arg;
+      continue;
+    }
+    char *p;
+    long v = strtol(arg, &p, 10);
+    if (*p != '\0' || v < 0 || (v == 0 && opt[1] != 's')) {
+      usage(program, "option value must be a positive integer\n");
+    }
+    switch (opt[1]) {
+    case 'm': maxExp = v; break;
+    case 'l': listMax = v; break;
+    case 'r': nReps = v; break;
+    case 's': seed = v; break;
+    }
+  }
+  if (maxExp > 8) usage(program, "MAX_EXP must be at most 8\n");
+
+  FILE *csv = NULL;
+  if (csvPath) {
+    if (!(csv = fopen(csvPath, "w"))) { perror(csvPath); exit(1); }
+    fprintf(csv, "backend,distribution,n,n_unique,op,reps,"
+            "ns_min,ns_p50,ns_per_element,bytes,bytes_per_element\n");
+  }
+  printf("%-7s %-10s %10s %10s %-13s %12s %10s %12s\n",
+         "backend", "dist", "n", "unique", "op", "us-p50", "ns/elem",
+         "bytes/elem");
+
+  int maxN = 1;
+  for (int e = 0; e < maxExp; e++) maxN *= 10;
+  int *a = malloc(maxN * sizeof(int));
+  int *b = malloc(maxN * sizeof(int));
+  double *ns = malloc(nReps * sizeof(double));
+  if (!a || !b || !ns) { perror("malloc"); exit(1); }
+  for (int d = 0; d < N_DISTRIBUTIONS; d++) {
+    for (int n = 10; n <= maxN; n *= 10) {
+      unsigned long state = (seed ^ (d * 1000003UL + n)) | 1;
+      make_elements(a, n, d, &state);
+      make_elements(b, n, d, &state);
+      void *unique = new_set(HASH_INT_SET, a, n);
+      int nUnique = nElementsIntSet(unique);
+      freeIntSet(unique);
+      for (int backend = 0; backend < N_INT_SET_BACKENDS; backend++) {
+        if (backend == LIST_INT_SET && n > listMax) continue;
+        for (int op = 0; op < N_OPS; op++) {
+          if (op == ADD && backend == ARRAY_INT_SET && n > listMax) continue;
+          long bytes = -1;
+          for (int r = 0; r < nReps; r++) {
+            ns[r] = time_op(op, backend, a, b, n, &bytes);
+          }
+          qsort(ns, nReps, sizeof(double), double_compare);
+          double p50 = ns[(nReps - 1)/2];
+          //set-algebra ops touch both inputs
+          double perElement = p50 / ((op == UNION || op == INTERSECTION) ? 2*n : n);
+          char bytesPerElement[32] = "";
+          if (op == ADD && bytes >= 0) {
+            snprintf(bytesPerElement, sizeof(bytesPerElement), "%.1f",
+                     (double)bytes / nUnique);
+          }
+          printf("%-7s %-10s %10d %10d %-13s %12.1f %10.1f %12s\n",
+                 BACKEND_NAMES[backend], DISTRIBUTION_NAMES[d], n, nUnique,
+                 OP_NAMES[op], p50/1e3, perElement, bytesPerElement);
+          if (csv) {
+            fprintf(csv, "%s,%s,%d,%d,%s,%d,%.0f,%.0f,%.2f,",
+                    BACKEND_NAMES[backend], DISTRIBUTION_NAMES[d], n, nUnique,
+                    OP_NAMES[op], nReps, ns[0], p50, perElement);
+            if (op == ADD && bytes >= 0) {
+              fprintf(csv, "%ld,%s\n", bytes, bytesPerElement);
+            }
+            else {
+              fprintf(csv, ",\n");
+            }
+          }
+        }
+      }
+    }
+  }
+  free(a);
+  free(b);
+  free(ns);
+  if (csv) fclose(csv);
+  return 0;
+}
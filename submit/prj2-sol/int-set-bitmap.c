@@ -0,0 +1,945 @@
+#include "int-set-bitmap.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Elements are split into a 16-bit key and a 16-bit low part after
+ *  flipping the sign bit, so that unsigned order of keys and low parts
+ *  matches int order of elements.
+ */
+static inline uint32_t toUnsigned(int element) {
+    return (uint32_t)element ^ 0x80000000u;
+}
+
+static inline uint16_t highBits(int element) {
+    return toUnsigned(element) >> 16;
+}
+
+static inline uint16_t lowBits(int element) {
+    return toUnsigned(element) & 0xFFFF;
+}
+
+static inline int toElement(uint16_t key, uint16_t low) {
+    return (int)((((uint32_t)key << 16) | low) ^ 0x80000000u);
+}
+
+/************************* Container Operations ************************/
+
+static int popcountWords(const uint64_t words[]) {
+    int n = 0;
+    for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) {
+        n += __builtin_popcountll(words[w]);
+    }
+    return n;
+}
+
+/** Set bits start..end (inclusive) of words[] */
+static void setRange(uint64_t words[], unsigned start, unsigned end) {
+    unsigned w0 = start >> 6, w1 = end >> 6;
+    uint64_t mask0 = ~0ULL << (start & 63);
+    uint64_t mask1 = ~0ULL >> (63 - (end & 63));
+    if (w0 == w1) {
+        words[w0] |= mask0 & mask1;
+        return;
+    }
+    words[w0] |= mask0;
+    for (unsigned w = w0 + 1; w < w1; w++) words[w] = ~0ULL;
+    words[w1] |= mask1;
+}
+
+/** Return index of first of values[n] which is >= v; n if none. */
+static int lowerBound16(const uint16_t values[], int n, uint16_t v) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (values[mid] < v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/** Return index of first of runs[nRuns] which ends at or after v;
+ *  nRuns if none.
+ */
+static int findRun(const Run runs[], int nRuns, uint16_t v) {
+    int lo = 0, hi = nRuns;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (runs[mid].start + runs[mid].length < v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int containerContains(const Container *c, uint16_t v) {
+    switch (c->type) {
+    case ARRAY_CONTAINER: {
+        int i = lowerBound16(c->values, c->cardinality, v);
+        return i < c->cardinality && c->values[i] == v;
+    }
+    case BITMAP_CONTAINER:
+        return (c->words[v >> 6] >> (v & 63)) & 1;
+    default: {
+        int i = findRun(c->runs, c->nRuns, v);
+        return i < c->nRuns && c->runs[i].start <= v;
+    }
+    }
+}
+
+/** Set the bit in words[] for each value in c */
+static void orContainerInto(uint64_t words[], const Container *c) {
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        for (int i = 0; i < c->cardinality; i++) {
+            words[c->values[i] >> 6] |= 1ULL << (c->values[i] & 63);
+        }
+        break;
+    case BITMAP_CONTAINER:
+        for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) {
+            words[w] |= c->words[w];
+        }
+        break;
+    default:
+        for (int i = 0; i < c->nRuns; i++) {
+            setRange(words, c->runs[i].start,
+                     c->runs[i].start + c->runs[i].length);
+        }
+    }
+}
+
+/** Fill words[BITMAP_CONTAINER_WORDS] with the bitmap for c */
+static void containerWords(const Container *c, uint64_t words[]) {
+    memset(words, 0, BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+    orContainerInto(words, c);
+}
+
+/** Replace the contents of c by the cardinality bits set in words[],
+ *  as an array container if small enough, else as a bitmap container.
+ *  words must come from malloc() and is taken over (or freed) by c.
+ *  Returns 0 on success, < 0 on error (c unchanged).
+ */
+static int setContainerWords(Container *c, uint64_t *words, int cardinality) {
+    if (cardinality <= MAX_ARRAY_CONTAINER) {
+        int capacity = cardinality > 0 ? cardinality : 1;
+        uint16_t *values = malloc(capacity * sizeof(uint16_t));
+        if (!values) { free(words); return -1; }
+        int n = 0;
+        for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) {
+            for (uint64_t x = words[w]; x != 0; x &= x - 1) {
+                values[n++] = w*64 + __builtin_ctzll(x);
+            }
+        }
+        free(words);
+        free(c->values);
+        c->type = ARRAY_CONTAINER;
+        c->values = values;
+        c->capacity = capacity;
+    }
+    else {
+        free(c->values);
+        c->type = BITMAP_CONTAINER;
+        c->words = words;
+        c->capacity = 0;
+    }
+    c->cardinality = cardinality;
+    c->nRuns = 0;
+    return 0;
+}
+
+/** Convert c to a bitmap container.  Returns < 0 on error. */
+static int toBitmapContainer(Container *c) {
+    uint64_t *words = malloc(BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+    if (!words) return -1;
+    containerWords(c, words);
+    free(c->values);
+    c->type = BITMAP_CONTAINER;
+    c->words = words;
+    c->capacity = 0;
+    c->nRuns = 0;
+    return 0;
+}
+
+/** Initialize c with key to hold the low bits of sorted[n] (all of
+ *  which must have high bits key).  Returns < 0 on error.
+ */
+static int makeContainer(Container *c, uint16_t key, const int sorted[], int n) {
+    memset(c, 0, sizeof(Container));
+    c->key = key;
+    c->cardinality = n;
+    if (n <= MAX_ARRAY_CONTAINER) {
+        c->type = ARRAY_CONTAINER;
+        c->capacity = n;
+        if (!(c->values = malloc(n * sizeof(uint16_t)))) return -1;
+        for (int i = 0; i < n; i++) c->values[i] = lowBits(sorted[i]);
+    }
+    else {
+        c->type = BITMAP_CONTAINER;
+        if (!(c->words = calloc(BITMAP_CONTAINER_WORDS, sizeof(uint64_t)))) {
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            uint16_t v = lowBits(sorted[i]);
+            c->words[v >> 6] |= 1ULL << (v & 63);
+        }
+    }
+    return 0;
+}
+
+/** Return # of bytes allocated for the values, words or runs of c */
+static size_t containerBytes(const Container *c) {
+    return (c->type == ARRAY_CONTAINER)
+        ? c->capacity * sizeof(uint16_t)
+        : (c->type == BITMAP_CONTAINER)
+        ? BITMAP_CONTAINER_WORDS * sizeof(uint64_t)
+        : c->capacity * sizeof(Run);
+}
+
+/** Make dest a deep copy of src.  Returns < 0 on error. */
+static int copyContainer(Container *dest, const Container *src) {
+    *dest = *src;
+    size_t size = containerBytes(src);
+    if (!(dest->values = malloc(size > 0 ? size : 1))) return -1;
+    memcpy(dest->values, src->values, size);
+    return 0;
+}
+
+/** Add v to c.  Returns 1 if added, 0 if already present, < 0 on
+ *  error.
+ */
+static int containerAdd(Container *c, uint16_t v) {
+    if (containerContains(c, v)) return 0;
+    if (c->type == RUN_CONTAINER) {
+        //expand runs to whichever of array or bitmap suits cardinality
+        uint64_t *words = malloc(BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+        if (!words) return -1;
+        containerWords(c, words);
+        if (setContainerWords(c, words, c->cardinality) < 0) return -1;
+    }
+    if (c->type == ARRAY_CONTAINER && c->cardinality == MAX_ARRAY_CONTAINER) {
+        if (toBitmapContainer(c) < 0) return -1;
+    }
+    if (c->type == BITMAP_CONTAINER) {
+        c->words[v >> 6] |= 1ULL << (v & 63);
+    }
+    else {
+        if (c->cardinality == c->capacity) {
+            int capacity = c->capacity < 4 ? 4 : 2*c->capacity;
+            if (capacity > MAX_ARRAY_CONTAINER) capacity = MAX_ARRAY_CONTAINER;
+            uint16_t *values = realloc(c->values, capacity * sizeof(uint16_t));
+            if (!values) return -1;
+            c->values = values;
+            c->capacity = capacity;
+        }
+        int i = lowerBound16(c->values, c->cardinality, v);
+        memmove(&c->values[i + 1], &c->values[i],
+                (c->cardinality - i) * sizeof(uint16_t));
+        c->values[i] = v;
+    }
+    c->cardinality++;
+    return 1;
+}
+
+/** Set a to the union of a and b.  Returns < 0 on error. */
+static int unionContainers(Container *a, const Container *b) {
+    if (a->type == ARRAY_CONTAINER && b->type == ARRAY_CONTAINER &&
+        a->cardinality + b->cardinality <= MAX_ARRAY_CONTAINER) {
+        int capacity = a->cardinality + b->cardinality;
+        uint16_t *values = malloc(capacity * sizeof(uint16_t));
+        if (!values) return -1;
+        int iA = 0, iB = 0, n = 0;
+        while (iA < a->cardinality && iB < b->cardinality) {
+            uint16_t vA = a->values[iA], vB = b->values[iB];
+            values[n++] = vA <= vB ? vA : vB;
+            iA += vA <= vB;
+            iB += vB <= vA;
+        }
+        while (iA < a->cardinality) values[n++] = a->values[iA++];
+        while (iB < b->cardinality) values[n++] = b->values[iB++];
+        free(a->values);
+        a->values = values;
+        a->capacity = capacity;
+        a->cardinality = n;
+        return 0;
+    }
+    uint64_t *words = malloc(BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+    if (!words) return -1;
+    containerWords(a, words);
+    orContainerInto(words, b);
+    return setContainerWords(a, words, popcountWords(words));
+}
+
+/** Set a to the intersection of a and b.  Returns < 0 on error. */
+static int intersectContainers(Container *a, const Container *b) {
+    if (a->type == ARRAY_CONTAINER) {
+        int n = 0;
+        for (int i = 0; i < a->cardinality; i++) {
+            if (containerContains(b, a->values[i])) a->values[n++] = a->values[i];
+        }
+        a->cardinality = n;
+        return 0;
+    }
+    if (b->type == ARRAY_CONTAINER) {
+        int capacity = b->cardinality > 0 ? b->cardinality : 1;
+        uint16_t *values = malloc(capacity * sizeof(uint16_t));
+        if (!values) return -1;
+        int n = 0;
+        for (int i = 0; i < b->cardinality; i++) {
+            if (containerContains(a, b->values[i])) values[n++] = b->values[i];
+        }
+        free(a->values);
+        a->type = ARRAY_CONTAINER;
+        a->values = values;
+        a->capacity = capacity;
+        a->cardinality = n;
+        a->nRuns = 0;
+        return 0;
+    }
+    uint64_t *words = malloc(BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+    if (!words) return -1;
+    containerWords(a, words);
+    if (b->type == BITMAP_CONTAINER) {
+        for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) words[w] &= b->words[w];
+    }
+    else {
+        uint64_t bWords[BITMAP_CONTAINER_WORDS];
+        containerWords(b, bWords);
+        for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) words[w] &= bWords[w];
+    }
+    return setContainerWords(a, words, popcountWords(words));
+}
+
+/** Return # of runs of consecutive values in c */
+static int countRuns(const Container *c) {
+    int nRuns = 0;
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        for (int i = 0; i < c->cardinality; i++) {
+            nRuns += (i == 0 || c->values[i] != c->values[i - 1] + 1);
+        }
+        break;
+    case BITMAP_CONTAINER: {
+        uint64_t carry = 0; //top bit of previous word
+        for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) {
+            uint64_t x = c->words[w];
+            nRuns += __builtin_popcountll(x & ~((x << 1) | carry));
+            carry = x >> 63;
+        }
+        break;
+    }
+    default:
+        nRuns = c->nRuns;
+    }
+    return nRuns;
+}
+
+/** Convert c to a run container if that is smaller.  Returns < 0 on
+ *  error (c unchanged).
+ */
+static int runOptimizeContainer(Container *c) {
+    if (c->type == RUN_CONTAINER) return 0;
+    int nRuns = countRuns(c);
+    size_t size = (c->type == ARRAY_CONTAINER)
+        ? c->cardinality * sizeof(uint16_t)
+        : BITMAP_CONTAINER_WORDS * sizeof(uint64_t);
+    if (nRuns * sizeof(Run) >= size) return 0;
+    Run *runs = malloc(nRuns * sizeof(Run));
+    if (!runs) return -1;
+    int n = -1;
+    int prev = -2;  //previous value; never adjacent to first value
+    if (c->type == ARRAY_CONTAINER) {
+        for (int i = 0; i < c->cardinality; i++) {
+            int v = c->values[i];
+            if (v == prev + 1) runs[n].length++;
+            else runs[++n] = (Run) { v, 0 };
+            prev = v;
+        }
+    }
+    else {
+        for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) {
+            for (uint64_t x = c->words[w]; x != 0; x &= x - 1) {
+                int v = w*64 + __builtin_ctzll(x);
+                if (v == prev + 1) runs[n].length++;
+                else runs[++n] = (Run) { v, 0 };
+                prev = v;
+            }
+        }
+    }
+    free(c->values);
+    c->type = RUN_CONTAINER;
+    c->runs = runs;
+    c->nRuns = c->capacity = nRuns;
+    return 0;
+}
+
+/*************************** Set Operations ****************************/
+
+/** Return index of first container of bitmap with key >= key */
+static int findContainer(const BitmapRep *bitmap, uint16_t key) {
+    int lo = 0, hi = bitmap->nContainers;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (bitmap->containers[mid].key < key) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/** Discard the rank index of bitmap; called whenever the cardinality
+ *  of a container may change.
+ */
+static void invalidateRanks(BitmapRep *bitmap) {
+    free(bitmap->ranks);
+    bitmap->ranks = NULL;
+}
+
+/** Set nElements of header to the total cardinality of its containers
+ *  and return it.
+ */
+static int updateCount(Header *header) {
+    invalidateRanks(&header->bitmap);
+    int n = 0;
+    for (int i = 0; i < header->bitmap.nContainers; i++) {
+        n += header->bitmap.containers[i].cardinality;
+    }
+    return header->nElements = n;
+}
+
+/** Return non-zero iff header contains element. */
+int isInBitmapIntSet(const Header *header, int element) {
+    const BitmapRep *bitmap = &header->bitmap;
+    uint16_t key = highBits(element);
+    int i = findContainer(bitmap, key);
+    return i < bitmap->nContainers && bitmap->containers[i].key == key &&
+        containerContains(&bitmap->containers[i], lowBits(element));
+}
+
+/** Add element to header.  Returns # of elements after addition,
+ *  < 0 on error with errno set.
+ */
+int addBitmapIntSet(Header *header, int element) {
+    BitmapRep *bitmap = &header->bitmap;
+    uint16_t key = highBits(element);
+    int i = findContainer(bitmap, key);
+    if (i == bitmap->nContainers || bitmap->containers[i].key != key) {
+        if (bitmap->nContainers == bitmap->capacity) {
+            int capacity = bitmap->capacity < 4 ? 4 : 2*bitmap->capacity;
+            Container *containers =
+                realloc(bitmap->containers, capacity * sizeof(Container));
+            if (!containers) return -1;
+            bitmap->containers = containers;
+            bitmap->capacity = capacity;
+        }
+        memmove(&bitmap->containers[i + 1], &bitmap->containers[i],
+                (bitmap->nContainers - i) * sizeof(Container));
+        bitmap->nContainers++;
+        memset(&bitmap->containers[i], 0, sizeof(Container));
+        bitmap->containers[i].key = key;
+        bitmap->containers[i].type = ARRAY_CONTAINER;
+    }
+    int nAdded = containerAdd(&bitmap->containers[i], lowBits(element));
+    if (nAdded != 0) invalidateRanks(bitmap);
+    if (nAdded < 0) return -1;
+    return header->nElements += nAdded;
+}
+
+/** Merge sorted[n], which must be strictly increasing, into header.
+ *  Returns # of elements after addition, < 0 on error with errno set.
+ */
+int addSortedBitmapIntSet(Header *header, const int sorted[], int n) {
+    BitmapRep *bitmap = &header->bitmap;
+    int nGroups = 0;
+    for (int i = 0; i < n; i++) {
+        nGroups += (i == 0 || highBits(sorted[i]) != highBits(sorted[i - 1]));
+    }
+    int capacity = bitmap->nContainers + nGroups;
+    Container *merged = malloc(capacity * sizeof(Container));
+    if (!merged) return -1;
+    //merge containers and groups of sorted[] by key; on error stop
+    //adding groups but keep all existing containers
+    int err = 0;
+    int iC = 0, nMerged = 0;
+    for (int i = 0; i < n && !err; ) {
+        uint16_t key = highBits(sorted[i]);
+        int j;
+        for (j = i + 1; j < n && highBits(sorted[j]) == key; j++) {}
+        while (iC < bitmap->nContainers && bitmap->containers[iC].key < key) {
+            merged[nMerged++] = bitmap->containers[iC++];
+        }
+        if (iC < bitmap->nContainers && bitmap->containers[iC].key == key) {
+            Container group;
+            Container *c = &merged[nMerged++];
+            *c = bitmap->containers[iC++];
+            err = makeContainer(&group, key, &sorted[i], j - i) < 0 ||
+                unionContainers(c, &group) < 0;
+            free(group.values);
+        }
+        else if (makeContainer(&merged[nMerged], key, &sorted[i], j - i) < 0) {
+            free(merged[nMerged].values);
+            err = 1;
+        }
+        else {
+            nMerged++;
+        }
+        i = j;
+    }
+    while (iC < bitmap->nContainers) merged[nMerged++] = bitmap->containers[iC++];
+    free(bitmap->containers);
+    bitmap->containers = merged;
+    bitmap->nContainers = nMerged;
+    bitmap->capacity = capacity;
+    updateCount(header);
+    return err ? -1 : header->nElements;
+}
+
+/** Return malloc()'d array of the elements of intSet in increasing
+ *  order, setting *n to their #.  Returns NULL on error.
+ */
+static int *sortedElements(const void *intSet, int *n) {
+    *n = nElementsIntSet((void *)intSet);
+    int *elements = malloc((*n > 0 ? *n : 1) * sizeof(int));
+    if (!elements) return NULL;
+    const void *iter = newIntSetIterator(intSet);
+    if (nextBatchIntSet(&iter, elements, *n) < *n) {
+        free(elements);
+        errno = ENOMEM; //iterator allocation failed
+        return NULL;
+    }
+    return elements;
+}
+
+/** Set header to its union with intSetB (of any representation).
+ *  Returns # of elements after union, < 0 on error with errno set.
+ */
+int unionBitmapIntSet(Header *header, const void *intSetB) {
+    const Header *headerB = (const Header *)intSetB;
+    if (headerB == header) return header->nElements;
+    if (headerB->backend != BITMAP_INT_SET) {
+        int n;
+        int *elements = sortedElements(intSetB, &n);
+        if (!elements) return -1;
+        int ret = addSortedBitmapIntSet(header, elements, n);
+        free(elements);
+        return ret;
+    }
+    BitmapRep *a = &header->bitmap;
+    const BitmapRep *b = &headerB->bitmap;
+    int capacity = a->nContainers + b->nContainers;
+    Container *merged = malloc(capacity * sizeof(Container));
+    if (!merged) return -1;
+    int err = 0;
+    int iA = 0, iB = 0, n = 0;
+    while (iA < a->nContainers || iB < b->nContainers) {
+        if (iB == b->nContainers ||
+            (iA < a->nContainers && a->containers[iA].key < b->containers[iB].key)) {
+            merged[n++] = a->containers[iA++];
+        }
+        else if (iA == a->nContainers || a->containers[iA].key > b->containers[iB].key) {
+            if (!err && copyContainer(&merged[n], &b->containers[iB]) == 0) n++;
+            else err = 1;
+            iB++;
+        }
+        else {
+            merged[n] = a->containers[iA++];
+            if (!err && unionContainers(&merged[n], &b->containers[iB]) < 0) {
+                err = 1;
+            }
+            n++; iB++;
+        }
+    }
+    free(a->containers);
+    a->containers = merged;
+    a->nContainers = n;
+    a->capacity = capacity;
+    updateCount(header);
+    return err ? -1 : header->nElements;
+}
+
+/** Set header to its intersection with intSetB (of any
+ *  representation).  Returns # of elements after intersection, < 0
+ *  on error with errno set.
+ */
+int intersectionBitmapIntSet(Header *header, const void *intSetB) {
+    const Header *headerB = (const Header *)intSetB;
+    if (headerB == header) return header->nElements;
+    if (headerB->backend != BITMAP_INT_SET) {
+        //intersect with a temporary bitmap copy of B
+        Header tmp = { .backend = BITMAP_INT_SET };
+        int n;
+        int *elements = sortedElements(intSetB, &n);
+        if (!elements) return -1;
+        int ret = addSortedBitmapIntSet(&tmp, elements, n);
+        free(elements);
+        if (ret >= 0) ret = intersectionBitmapIntSet(header, &tmp);
+        freeBitmapIntSet(&tmp);
+        return ret;
+    }
+    BitmapRep *a = &header->bitmap;
+    const BitmapRep *b = &headerB->bitmap;
+    int err = 0;
+    int iB = 0, n = 0;
+    for (int iA = 0; iA < a->nContainers; iA++) {
+        Container *c = &a->containers[iA];
+        while (iB < b->nContainers && b->containers[iB].key < c->key) iB++;
+        int isKept = iB < b->nContainers && b->containers[iB].key == c->key;
+        if (isKept && !err && intersectContainers(c, &b->containers[iB]) < 0) {
+            err = 1;
+        }
+        if (isKept && c->cardinality > 0) {
+            a->containers[n++] = *c;
+        }
+        else {
+            free(c->values);
+        }
+    }
+    a->nContainers = n;
+    updateCount(header);
+    return err ? -1 : header->nElements;
+}
+
+/** Convert each chunk of header to run-length encoding if that is
+ *  smaller than its array or bitmap encoding.
+ */
+void runOptimizeBitmapIntSet(Header *header) {
+    for (int i = 0; i < header->bitmap.nContainers; i++) {
+        runOptimizeContainer(&header->bitmap.containers[i]);
+    }
+}
+
+/** Move the chunks of tail, all of whose elements must exceed those of
+ *  header, onto the end of header, leaving tail empty.  Returns # of
+ *  elements of header after appending, < 0 on error with errno set
+ *  (leaving both unchanged).
+ */
+int appendBitmapIntSet(Header *header, Header *tail) {
+    BitmapRep *bitmap = &header->bitmap;
+    int n = bitmap->nContainers + tail->bitmap.nContainers;
+    if (n > bitmap->capacity) {
+        Container *containers = realloc(bitmap->containers, n * sizeof(Container));
+        if (!containers) return -1;
+        bitmap->containers = containers;
+        bitmap->capacity = n;
+    }
+    if (tail->bitmap.nContainers > 0) {
+        memcpy(&bitmap->containers[bitmap->nContainers], tail->bitmap.containers,
+               tail->bitmap.nContainers * sizeof(Container));
+    }
+    bitmap->nContainers = n;
+    invalidateRanks(bitmap);
+    header->nElements += tail->nElements;
+    tail->bitmap.nContainers = 0;
+    tail->nElements = 0;
+    invalidateRanks(&tail->bitmap);
+    return header->nElements;
+}
+
+/** Return # of bytes allocated for the chunks of header, including its
+ *  rank index if built.
+ */
+size_t memoryUsageBitmapIntSet(const Header *header) {
+    const BitmapRep *bitmap = &header->bitmap;
+    size_t size = bitmap->capacity * sizeof(Container);
+    for (int i = 0; i < bitmap->nContainers; i++) {
+        size += containerBytes(&bitmap->containers[i]);
+    }
+    if (bitmap->ranks) size += (bitmap->nContainers + 1) * sizeof(int);
+    return size;
+}
+
+/** Return # of bytes of chunks which addSortedBitmapIntSet() followed by
+ *  runOptimizeBitmapIntSet() would allocate for sorted[n] in an empty
+ *  BITMAP_INT_SET, without building them.
+ */
+size_t compactBitmapSize(const int sorted[], int n) {
+    size_t size = 0;
+    for (int i = 0; i < n; ) {
+        uint16_t key = highBits(sorted[i]);
+        int nRuns = 1;
+        int j;
+        for (j = i + 1; j < n && highBits(sorted[j]) == key; j++) {
+            nRuns += (sorted[j] != sorted[j - 1] + 1);
+        }
+        //as makeContainer() then runOptimizeContainer() choose
+        size_t packed = (j - i <= MAX_ARRAY_CONTAINER)
+            ? (j - i) * sizeof(uint16_t)
+            : BITMAP_CONTAINER_WORDS * sizeof(uint64_t);
+        size_t runs = nRuns * sizeof(Run);
+        size += sizeof(Container) + (runs < packed ? runs : packed);
+        i = j;
+    }
+    return size;
+}
+
+/** Free the chunks of header (but not header itself). */
+void freeBitmapIntSet(Header *header) {
+    for (int i = 0; i < header->bitmap.nContainers; i++) {
+        free(header->bitmap.containers[i].values);
+    }
+    free(header->bitmap.containers);
+    free(header->bitmap.ranks);
+}
+
+/**************************** Order Queries ****************************/
+
+/** Return # of values of c which are < v */
+static int containerRank(const Container *c, uint16_t v) {
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        return lowerBound16(c->values, c->cardinality, v);
+    case BITMAP_CONTAINER: {
+        int n = 0;
+        for (int w = 0; w < (v >> 6); w++) n += __builtin_popcountll(c->words[w]);
+        return n + __builtin_popcountll(c->words[v >> 6] & ((1ULL << (v & 63)) - 1));
+    }
+    default: {
+        int n = 0;
+        for (int i = 0; i < c->nRuns && c->runs[i].start < v; i++) {
+            int end = c->runs[i].start + c->runs[i].length;
+            n += (end < v ? end + 1 : v) - c->runs[i].start;
+        }
+        return n;
+    }
+    }
+}
+
+/** Return the value of c with rank k, 0 <= k < c->cardinality */
+static uint16_t containerSelect(const Container *c, int k) {
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        return c->values[k];
+    case BITMAP_CONTAINER: {
+        int w;
+        for (w = 0; k >= __builtin_popcountll(c->words[w]); w++) {
+            k -= __builtin_popcountll(c->words[w]);
+        }
+        uint64_t x = c->words[w];
+        for (; k > 0; k--) x &= x - 1; //clear lowest k bits
+        return w*64 + __builtin_ctzll(x);
+    }
+    default: {
+        int i;
+        for (i = 0; k > c->runs[i].length; i++) k -= c->runs[i].length + 1;
+        return c->runs[i].start + k;
+    }
+    }
+}
+
+/** Build bitmap->ranks[nContainers + 1] if it is out of date.  Returns
+ *  < 0 if it cannot be allocated.
+ */
+static int buildRanks(BitmapRep *bitmap) {
+    if (bitmap->ranks) return 0;
+    int *ranks = malloc((bitmap->nContainers + 1) * sizeof(int));
+    if (!ranks) return -1;
+    ranks[0] = 0;
+    for (int i = 0; i < bitmap->nContainers; i++) {
+        ranks[i + 1] = ranks[i] + bitmap->containers[i].cardinality;
+    }
+    bitmap->ranks = ranks;
+    return 0;
+}
+
+/** Return # of elements of header which are < element. */
+int rankBitmapIntSet(Header *header, int element) {
+    BitmapRep *bitmap = &header->bitmap;
+    uint16_t key = highBits(element);
+    int i = findContainer(bitmap, key);
+    int rank = 0;
+    if (buildRanks(bitmap) == 0) {
+        rank = bitmap->ranks[i];
+    }
+    else { //no memory for the index: sum counts directly
+        for (int j = 0; j < i; j++) rank += bitmap->containers[j].cardinality;
+    }
+    if (i < bitmap->nContainers && bitmap->containers[i].key == key) {
+        rank += containerRank(&bitmap->containers[i], lowBits(element));
+    }
+    return rank;
+}
+
+/** Return the element of header with rank k, 0 <= k < header->nElements. */
+int selectBitmapIntSet(Header *header, int k) {
+    BitmapRep *bitmap = &header->bitmap;
+    int i = 0;
+    if (buildRanks(bitmap) == 0) {
+        //find container i with ranks[i] <= k < ranks[i + 1]
+        int hi = bitmap->nContainers - 1;
+        while (i < hi) {
+            int mid = i + (hi - i)/2;
+            if (bitmap->ranks[mid + 1] <= k) i = mid + 1; else hi = mid;
+        }
+        k -= bitmap->ranks[i];
+    }
+    else {
+        for (; k >= bitmap->containers[i].cardinality; i++) {
+            k -= bitmap->containers[i].cardinality;
+        }
+    }
+    const Container *c = &bitmap->containers[i];
+    return toElement(c->key, containerSelect(c, k));
+}
+
+/****************************** Iteration ******************************/
+
+/** Return position of first value in non-empty container c */
+static int firstPosition(const Container *c) {
+    if (c->type != BITMAP_CONTAINER) return 0;
+    int w;
+    for (w = 0; c->words[w] == 0; w++) {}
+    return w*64 + __builtin_ctzll(c->words[w]);
+}
+
+/** Set iterator to the first element of header; header must not be
+ *  empty.
+ */
+void startBitmapIterator(Iterator *iterator) {
+    iterator->container = 0;
+    iterator->position = firstPosition(&iterator->header->bitmap.containers[0]);
+    iterator->offset = 0;
+}
+
+/** Return current element of iterator. */
+int bitmapIteratorElement(const Iterator *iterator) {
+    const Container *c = &iterator->header->bitmap.containers[iterator->container];
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        return toElement(c->key, c->values[iterator->position]);
+    case BITMAP_CONTAINER:
+        return toElement(c->key, iterator->position);
+    default:
+        return toElement(c->key, c->runs[iterator->position].start + iterator->offset);
+    }
+}
+
+/** Step iterator; return non-zero iff it was already at the last element. */
+int stepBitmapIterator(Iterator *iterator) {
+    const BitmapRep *bitmap = &iterator->header->bitmap;
+    const Container *c = &bitmap->containers[iterator->container];
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        if (++iterator->position < c->cardinality) return 0;
+        break;
+    case BITMAP_CONTAINER: {
+        int w = iterator->position >> 6;
+        //clear bits up to and including current position
+        uint64_t x = c->words[w] & ((~0ULL << (iterator->position & 63)) << 1);
+        while (x == 0 && ++w < BITMAP_CONTAINER_WORDS) x = c->words[w];
+        if (x != 0) {
+            iterator->position = w*64 + __builtin_ctzll(x);
+            return 0;
+        }
+        break;
+    }
+    default:
+        if (++iterator->offset <= c->runs[iterator->position].length) return 0;
+        iterator->offset = 0;
+        if (++iterator->position < c->nRuns) return 0;
+    }
+    if (++iterator->container >= bitmap->nContainers) return 1;
+    iterator->position = firstPosition(&bitmap->containers[iterator->container]);
+    iterator->offset = 0;
+    return 0;
+}
+
+/** Copy up to max elements from iterator to out[] and step past them.
+ *  Returns # copied, setting *isDone iff the last element was copied.
+ */
+int batchBitmapIterator(Iterator *iterator, int out[], int max, int *isDone) {
+    const BitmapRep *bitmap = &iterator->header->bitmap;
+    int n = 0;
+    *isDone = 0;
+    while (n < max) {
+        const Container *c = &bitmap->containers[iterator->container];
+        int isEnd = 0; //past last value of c
+        switch (c->type) {
+        case ARRAY_CONTAINER:
+            while (n < max && iterator->position < c->cardinality) {
+                out[n++] = toElement(c->key, c->values[iterator->position++]);
+            }
+            isEnd = iterator->position == c->cardinality;
+            break;
+        case BITMAP_CONTAINER: {
+            int w = iterator->position >> 6;
+            uint64_t x = c->words[w] & (~0ULL << (iterator->position & 63));
+            for (;;) {
+                for (; x != 0 && n < max; x &= x - 1) {
+                    out[n++] = toElement(c->key, w*64 + __builtin_ctzll(x));
+                }
+                if (x != 0) {
+                    iterator->position = w*64 + __builtin_ctzll(x);
+                    break;
+                }
+                if (++w == BITMAP_CONTAINER_WORDS) {
+                    isEnd = 1;
+                    break;
+                }
+                x = c->words[w];
+            }
+            break;
+        }
+        default:
+            while (n < max && iterator->position < c->nRuns) {
+                const Run *run = &c->runs[iterator->position];
+                out[n++] = toElement(c->key, run->start + iterator->offset);
+                if (++iterator->offset > run->length) {
+                    iterator->offset = 0;
+                    iterator->position++;
+                }
+            }
+            isEnd = iterator->position == c->nRuns;
+        }
+        if (!isEnd) break;
+        if (++iterator->container >= bitmap->nContainers) {
+            *isDone = 1;
+            break;
+        }
+        iterator->position = firstPosition(&bitmap->containers[iterator->container]);
+        iterator->offset = 0;
+    }
+    return n;
+}
+
+/** Set the position (and offset) of iterator to the first value of c
+ *  which is >= v; return 0 if there is none.
+ */
+static int seekContainer(const Container *c, uint16_t v, Iterator *iterator) {
+    iterator->offset = 0;
+    switch (c->type) {
+    case ARRAY_CONTAINER:
+        iterator->position = lowerBound16(c->values, c->cardinality, v);
+        return iterator->position < c->cardinality;
+    case BITMAP_CONTAINER: {
+        int w = v >> 6;
+        uint64_t x = c->words[w] & (~0ULL << (v & 63));
+        while (x == 0 && ++w < BITMAP_CONTAINER_WORDS) x = c->words[w];
+        if (x == 0) return 0;
+        iterator->position = w*64 + __builtin_ctzll(x);
+        return 1;
+    }
+    default: {
+        int i = findRun(c->runs, c->nRuns, v);
+        if (i == c->nRuns) return 0;
+        iterator->position = i;
+        if (v > c->runs[i].start) iterator->offset = v - c->runs[i].start;
+        return 1;
+    }
+    }
+}
+
+/** Set iterator to the first element of header which is >= lo; return
+ *  non-zero iff there is no such element.
+ */
+int seekBitmapIterator(Iterator *iterator, int lo) {
+    const BitmapRep *bitmap = &iterator->header->bitmap;
+    uint16_t key = highBits(lo);
+    int i = findContainer(bitmap, key);
+    if (i < bitmap->nContainers && bitmap->containers[i].key == key) {
+        iterator->container = i;
+        if (seekContainer(&bitmap->containers[i], lowBits(lo), iterator)) {
+            return 0;
+        }
+        i++;
+    }
+    if (i >= bitmap->nContainers) return 1;
+    iterator->container = i;
+    iterator->position = firstPosition(&bitmap->containers[i]);
+    iterator->offset = 0;
+    return 0;
+}
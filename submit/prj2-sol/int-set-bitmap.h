@@ -0,0 +1,94 @@
+#ifndef INT_SET_BITMAP_H_
+#define INT_SET_BITMAP_H_
+
+#include "int-set.h"
+
+/** Compressed-bitmap representation for int-sets (BITMAP_INT_SET),
+ *  following the Roaring bitmap design: the 32-bit space is split into
+ *  2**16 chunks by the high 16 bits of each element and each non-empty
+ *  chunk is stored as a sorted array of its low 16 bits, a 2**16-bit
+ *  bitmap or a list of runs, whichever suits its contents.
+ *
+ *  These routines are called by the int-set.c entry points after
+ *  dispatching on header->backend; they all require
+ *  header->backend == BITMAP_INT_SET.
+ */
+
+/** Return non-zero iff header contains element. */
+int isInBitmapIntSet(const Header *header, int element);
+
+/** Add element to header.  Returns # of elements after addition,
+ *  < 0 on error with errno set.
+ */
+int addBitmapIntSet(Header *header, int element);
+
+/** Merge sorted[n], which must be strictly increasing, into header.
+ *  Returns # of elements after addition, < 0 on error with errno set.
+ */
+int addSortedBitmapIntSet(Header *header, const int sorted[], int n);
+
+/** Set header to its union with intSetB (of any representation).
+ *  Returns # of elements after union, < 0 on error with errno set.
+ */
+int unionBitmapIntSet(Header *header, const void *intSetB);
+
+/** Set header to its intersection with intSetB (of any
+ *  representation).  Returns # of elements after intersection, < 0
+ *  on error with errno set.
+ */
+int intersectionBitmapIntSet(Header *header, const void *intSetB);
+
+/** Convert each chunk of header to run-length encoding if that is
+ *  smaller than its array or bitmap encoding.
+ */
+void runOptimizeBitmapIntSet(Header *header);
+
+/** Move the chunks of tail, all of whose elements must exceed those of
+ *  header, onto the end of header, leaving tail empty.  Returns # of
+ *  elements of header after appending, < 0 on error with errno set
+ *  (leaving both unchanged).
+ */
+int appendBitmapIntSet(Header *header, Header *tail);
+
+/** Return # of bytes allocated for the chunks of header, including its
+ *  rank index if built.
+ */
+size_t memoryUsageBitmapIntSet(const Header *header);
+
+/** Return # of bytes of chunks which addSortedBitmapIntSet() followed by
+ *  runOptimizeBitmapIntSet() would allocate for sorted[n] in an empty
+ *  BITMAP_INT_SET, without building them.
+ */
+size_t compactBitmapSize(const int sorted[], int n);
+
+/** Free the chunks of header (but not header itself). */
+void freeBitmapIntSet(Header *header);
+
+/** Return # of elements of header which are < element. */
+int rankBitmapIntSet(Header *header, int element);
+
+/** Return the element of header with rank k, 0 <= k < header->nElements. */
+int selectBitmapIntSet(Header *header, int k);
+
+/** Set iterator to the first element of header; header must not be
+ *  empty.
+ */
+void startBitmapIterator(Iterator *iterator);
+
+/** Return current element of iterator. */
+int bitmapIteratorElement(const Iterator *iterator);
+
+/** Step iterator; return non-zero iff it was already at the last element. */
+int stepBitmapIterator(Iterator *iterator);
+
+/** Copy up to max elements from iterator to out[] and step past them.
+ *  Returns # copied, setting *isDone iff the last element was copied.
+ */
+int batchBitmapIterator(Iterator *iterator, int out[], int max, int *isDone);
+
+/** Set iterator to the first element of header which is >= lo; return
+ *  non-zero iff there is no such element.
+ */
+int seekBitmapIterator(Iterator *iterator, int lo);
+
+#endif //ifndef INT_SET_BITMAP_H_
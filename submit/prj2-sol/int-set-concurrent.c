@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L  //for sched_yield() under -std=c18
+
+#include "int-set-concurrent.h"
+#include "int-set.h"
+#include "int-merge.h"
+#include "int-sort.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    CACHE_LINE = 64,      //bytes; keeps reader counters apart
+    N_READER_STRIPES = 32 //# of counters readers are spread across
+};
+
+typedef struct { //immutable once published
+    int nElements;
+    int elements[]; //strictly increasing
+} Snapshot;
+
+typedef struct { //# of readers in progress on one stripe
+    _Alignas(CACHE_LINE) atomic_long count;
+} ReaderCount;
+
+typedef struct {
+    _Atomic(Snapshot *) current; //published elements
+    atomic_uint epoch;           //parity selects readers[] for new readers
+    ReaderCount readers[2][N_READER_STRIPES];
+    pthread_mutex_t writeLock;   //serializes writers
+} ConcurrentIntSet;
+
+/** Stripe used by the calling thread, assigned round-robin on first use */
+static _Thread_local int readerStripe = -1;
+static atomic_int nextReaderStripe;
+
+/** Announce a reader of set and return the parity it must pass to
+ *  exitReader().  After this the current snapshot of set will not be
+ *  freed until exitReader().
+ */
+static int enterReader(ConcurrentIntSet *set) {
+    if (readerStripe < 0) {
+        readerStripe = atomic_fetch_add(&nextReaderStripe, 1) % N_READER_STRIPES;
+    }
+    int parity = atomic_load(&set->epoch) & 1;
+    atomic_fetch_add(&set->readers[parity][readerStripe].count, 1);
+    return parity;
+}
+
+static void exitReader(ConcurrentIntSet *set, int parity) {
+    atomic_fetch_sub(&set->readers[parity][readerStripe].count, 1);
+}
+
+/** Wait until no reader counted under parity is in progress */
+static void waitForReaders(ConcurrentIntSet *set, int parity) {
+    for (;;) {
+        long n = 0;
+        for (int s = 0; s < N_READER_STRIPES; s++) {
+            n += atomic_load(&set->readers[parity][s].count);
+        }
+        if (n == 0) return;
+        sched_yield();
+    }
+}
+
+/** Replace the snapshot of set by snapshot and free the old one once
+ *  no reader can still be using it.  Must be called with writeLock.
+ *
+ *  A reader which saw the old snapshot entered before it was replaced
+ *  and is counted under one parity or the other.  Flipping the epoch
+ *  sends new readers to the other parity, so each wait finishes even
+ *  while readers keep arriving; waiting on both parities in turn
+ *  covers readers which read the epoch just before a flip.
+ */
+static void publish(ConcurrentIntSet *set, Snapshot *snapshot) {
+    Snapshot *old = atomic_exchange(&set->current, snapshot);
+    for (int i = 0; i < 2; i++) {
+        int parity = atomic_fetch_add(&set->epoch, 1) & 1;
+        waitForReaders(set, parity);
+    }
+    free(old);
+}
+
+static Snapshot *newSnapshot(int nElements) {
+    Snapshot *snapshot = malloc(sizeof(Snapshot) + nElements*sizeof(int));
+    if (snapshot) snapshot->nElements = nElements;
+    return snapshot;
+}
+
+/** Return a new empty concurrent int-set.  Returns NULL on error with
+ *  errno set.
+ */
+void *newConcurrentIntSet(void) {
+    //aligned so that each reader stripe has a cache line of its own
+    ConcurrentIntSet *set = aligned_alloc(CACHE_LINE, sizeof(ConcurrentIntSet));
+    if (set) memset(set, 0, sizeof(ConcurrentIntSet));
+    Snapshot *snapshot = newSnapshot(0);
+    int err = (!set || !snapshot) ? ENOMEM
+        : pthread_mutex_init(&set->writeLock, NULL);
+    if (err) {
+        free(set);
+        free(snapshot);
+        errno = err;
+        return NULL;
+    }
+    atomic_init(&set->current, snapshot);
+    return set;
+}
+
+/** Return # of elements in intSet.  Wait-free. */
+int nElementsConcurrentIntSet(void *intSet) {
+    ConcurrentIntSet *set = (ConcurrentIntSet *)intSet;
+    int parity = enterReader(set);
+    int n = atomic_load(&set->current)->nElements;
+    exitReader(set, parity);
+    return n;
+}
+
+/** Return index of first of elements[n] which is >= value; n if none */
+static int lowerBound(const int elements[], int n, int value) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (elements[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/** Return non-zero iff intSet contains element.  Wait-free. */
+int isInConcurrentIntSet(void *intSet, int element) {
+    ConcurrentIntSet *set = (ConcurrentIntSet *)intSet;
+    int parity = enterReader(set);
+    const Snapshot *snapshot = atomic_load(&set->current);
+    int i = lowerBound(snapshot->elements, snapshot->nElements, element);
+    int isIn = i < snapshot->nElements && snapshot->elements[i] == element;
+    exitReader(set, parity);
+    return isIn;
+}
+
+/** Add element to intSet.  Returns # of elements in intSet after
+ *  addition, < 0 on error with errno set.
+ */
+int addConcurrentIntSet(void *intSet, int element) {
+    ConcurrentIntSet *set = (ConcurrentIntSet *)intSet;
+    pthread_mutex_lock(&set->writeLock);
+    //only writers replace current, so it is stable under writeLock
+    const Snapshot *old = atomic_load(&set->current);
+    int n = old->nElements;
+    int i = lowerBound(old->elements, n, element);
+    if (i == n || old->elements[i] != element) {
+        Snapshot *snapshot = newSnapshot(n + 1);
+        if (!snapshot) {
+            n = -1;
+        }
+        else {
+            memcpy(snapshot->elements, old->elements, i * sizeof(int));
+            snapshot->elements[i] = element;
+            memcpy(&snapshot->elements[i + 1], &old->elements[i],
+                   (n - i) * sizeof(int));
+            publish(set, snapshot);
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&set->writeLock);
+    return n;
+}
+
+/** Add all of elements[nElements] to intSet, publishing them together.
+ *  Returns # of elements in intSet after addition, < 0 on error with
+ *  errno set.
+ */
+int addMultipleConcurrentIntSet(void *intSet, const int elements[],
+                                int nElements) {
+    ConcurrentIntSet *set = (ConcurrentIntSet *)intSet;
+    if (nElements <= 0) return nElementsConcurrentIntSet(intSet);
+    //sort outside the lock so that other writers are not held up
+    int *sorted = malloc(nElements * sizeof(int));
+    if (!sorted) return -1;
+    memcpy(sorted, elements, nElements * sizeof(int));
+    int nSorted = sortUniqueInts(sorted, nElements);
+    if (nSorted < 0) {
+        free(sorted);
+        return -1;
+    }
+    pthread_mutex_lock(&set->writeLock);
+    const Snapshot *old = atomic_load(&set->current);
+    Snapshot *snapshot = newSnapshot(old->nElements + nSorted);
+    int n = -1;
+    if (snapshot) {
+        n = snapshot->nElements =
+            unionSortedInts(old->elements, old->nElements, sorted, nSorted,
+                            snapshot->elements);
+        publish(set, snapshot);
+    }
+    pthread_mutex_unlock(&set->writeLock);
+    free(sorted);
+    return n;
+}
+
+/** Return a new ARRAY_INT_SET int-set (see int-set.h) holding the
+ *  elements of intSet at some instant, for iteration or set algebra
+ *  without holding up writers.  Returns NULL on error with errno set.
+ */
+void *snapshotConcurrentIntSet(void *intSet) {
+    ConcurrentIntSet *set = (ConcurrentIntSet *)intSet;
+    Header *header = newBackendIntSet(ARRAY_INT_SET);
+    if (!header) return NULL;
+    int parity = enterReader(set);
+    const Snapshot *snapshot = atomic_load(&set->current);
+    int n = snapshot->nElements;
+    int *elements = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (elements) memcpy(elements, snapshot->elements, n * sizeof(int));
+    exitReader(set, parity);
+    if (!elements) {
+        freeIntSet(header);
+        return NULL;
+    }
+    header->array.elements = elements;
+    header->array.capacity = n;
+    header->nElements = n;
+    return header;
+}
+
+/** Free intSet, which must no longer be in use by any thread. */
+void freeConcurrentIntSet(void *intSet) {
+    ConcurrentIntSet *set = (ConcurrentIntSet *)intSet;
+    pthread_mutex_destroy(&set->writeLock);
+    free(atomic_load(&set->current));
+    free(set);
+}
@@ -0,0 +1,51 @@
+#ifndef INT_SET_CONCURRENT_H_
+#define INT_SET_CONCURRENT_H_
+
+/** Thread-safe int-set.  Its elements are held in an immutable sorted
+ *  array which writers replace wholesale (read-copy-update):
+ *
+ *    - Readers never block and never retry: isInConcurrentIntSet()
+ *      and nElementsConcurrentIntSet() are wait-free.  Readers
+ *      announce themselves on per-thread striped counters, so that
+ *      reader throughput scales with the # of reader threads.
+ *
+ *    - Writers are serialized by a mutex.  Each write builds a new
+ *      array, publishes it and frees the old one only after every
+ *      reader which might still see it has finished.
+ *
+ *  Writes cost O(n), so batches should use addMultipleConcurrentIntSet().
+ */
+
+/** Return a new empty concurrent int-set.  Returns NULL on error with
+ *  errno set.
+ */
+void *newConcurrentIntSet(void);
+
+/** Return # of elements in intSet.  Wait-free. */
+int nElementsConcurrentIntSet(void *intSet);
+
+/** Return non-zero iff intSet contains element.  Wait-free. */
+int isInConcurrentIntSet(void *intSet, int element);
+
+/** Add element to intSet.  Returns # of elements in intSet after
+ *  addition, < 0 on error with errno set.
+ */
+int addConcurrentIntSet(void *intSet, int element);
+
+/** Add all of elements[nElements] to intSet, publishing them together.
+ *  Returns # of elements in intSet after addition, < 0 on error with
+ *  errno set.
+ */
+int addMultipleConcurrentIntSet(void *intSet, const int elements[],
+                                int nElements);
+
+/** Return a new ARRAY_INT_SET int-set (see int-set.h) holding the
+ *  elements of intSet at some instant, for iteration or set algebra
+ *  without holding up writers.  Returns NULL on error with errno set.
+ */
+void *snapshotConcurrentIntSet(void *intSet);
+
+/** Free intSet, which must no longer be in use by any thread. */
+void freeConcurrentIntSet(void *intSet);
+
+#endif //ifndef INT_SET_CONCURRENT_H_
@@ -0,0 +1,356 @@
+#define _POSIX_C_SOURCE 200809L  //for mmap() and friends under -std=c18
+
+#include "int-set-file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+    FILE_MAGIC = 0x54455349, //"ISET" when read as little-endian bytes
+    FILE_VERSION = 1,
+    DATA_PAD = 8             //zero bytes after data so gaps load 8 bytes
+};
+
+typedef struct { //start of an int-set file
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nElements;
+    uint32_t nBlocks;
+    uint64_t dataSize;      //# of bytes of packed gaps, including DATA_PAD
+} FileHeader;
+
+//the file is FileHeader, FileBlock blocks[nBlocks], uint8_t data[dataSize]
+
+/** Return # of elements in block b of nBlocks for a set of nElements */
+static inline int blockCount(int b, int nBlocks, int nElements) {
+    return b < nBlocks - 1
+        ? INT_SET_FILE_BLOCK : nElements - (nBlocks - 1)*INT_SET_FILE_BLOCK;
+}
+
+/** Return # of bytes of packed gaps for a block of n elements */
+static inline uint64_t packedSize(int n, uint32_t width) {
+    return ((uint64_t)(n - 1)*width + 7) / 8;
+}
+
+/** Return gap i of the block whose gaps start at data[] */
+static inline uint32_t gapAt(const uint8_t data[], uint32_t width, int i) {
+    if (width == 0) return 0;
+    uint64_t bit = (uint64_t)i * width;
+    uint64_t word;
+    memcpy(&word, &data[bit/8], sizeof(word));  //DATA_PAD makes this safe
+    return (word >> (bit % 8)) & ((1ULL << width) - 1);
+}
+
+/** Return the element after prev, given the gap between them */
+static inline int nextElement(int prev, uint32_t gap) {
+    return (int)((uint32_t)prev + gap + 1);
+}
+
+/******************************* Writing *******************************/
+
+/** Pack the gaps of sorted[n] (a whole block) at the smallest width
+ *  which holds them all into data[], setting *block.  Returns # of
+ *  bytes written.
+ */
+static size_t packBlock(const int sorted[], int n, uint8_t data[],
+                        FileBlock *block) {
+    uint32_t maxGap = 0;
+    for (int i = 1; i < n; i++) {
+        uint32_t gap = (uint32_t)sorted[i] - (uint32_t)sorted[i - 1] - 1;
+        if (gap > maxGap) maxGap = gap;
+    }
+    uint32_t width = maxGap == 0 ? 0 : 32 - __builtin_clz(maxGap);
+    block->first = sorted[0];
+    block->width = width;
+    uint64_t acc = 0; //bits not yet written, low bits first
+    int nAccBits = 0;
+    size_t size = 0;
+    for (int i = 1; i < n; i++) {
+        uint32_t gap = (uint32_t)sorted[i] - (uint32_t)sorted[i - 1] - 1;
+        acc |= (uint64_t)gap << nAccBits;
+        for (nAccBits += width; nAccBits >= 8; nAccBits -= 8) {
+            data[size++] = acc & 0xFF;
+            acc >>= 8;
+        }
+    }
+    if (nAccBits > 0) data[size++] = acc & 0xFF;
+    return size;
+}
+
+/** Write intSet (of any representation) to a new file at path.
+ *  Returns 0 on success, < 0 on error with errno set.
+ */
+int writeIntSet(void *intSet, const char *path) {
+    int n = nElementsIntSet(intSet);
+    int nBlocks = (n + INT_SET_FILE_BLOCK - 1) / INT_SET_FILE_BLOCK;
+    int *sorted = malloc((n > 0 ? n : 1) * sizeof(int));
+    FileBlock *blocks = malloc((nBlocks > 0 ? nBlocks : 1) * sizeof(FileBlock));
+    //no gap is wider than 32 bits
+    uint8_t *data = calloc((size_t)n * sizeof(uint32_t) + DATA_PAD, 1);
+    if (!sorted || !blocks || !data) {
+        free(sorted); free(blocks); free(data);
+        return -1;
+    }
+    const void *iter = newIntSetIterator(intSet);
+    if (nextBatchIntSet(&iter, sorted, n) < n) {
+        free(sorted); free(blocks); free(data);
+        errno = ENOMEM; //iterator allocation failed
+        return -1;
+    }
+    size_t dataSize = 0;
+    for (int b = 0; b < nBlocks; b++) {
+        blocks[b].offset = dataSize;
+        dataSize += packBlock(&sorted[b*INT_SET_FILE_BLOCK],
+                              blockCount(b, nBlocks, n), &data[dataSize],
+                              &blocks[b]);
+    }
+    dataSize += DATA_PAD;
+    FileHeader header = {
+        .magic = FILE_MAGIC, .version = FILE_VERSION,
+        .nElements = n, .nBlocks = nBlocks, .dataSize = dataSize,
+    };
+    FILE *out = fopen(path, "wb");
+    int ret = -1;
+    if (out) {
+        int isOk = fwrite(&header, sizeof(header), 1, out) == 1 &&
+            fwrite(blocks, sizeof(FileBlock), nBlocks, out) == nBlocks &&
+            fwrite(data, 1, dataSize, out) == dataSize;
+        if (fclose(out) == 0 && isOk) ret = 0;
+    }
+    free(sorted);
+    free(blocks);
+    free(data);
+    return ret;
+}
+
+/******************************* Reading *******************************/
+
+/** Return non-zero iff the size and table of the file mapped at map[size]
+ *  are consistent, so that no lookup can read outside the mapping.
+ */
+static int isValidFile(const void *map, size_t size) {
+    if (size < sizeof(FileHeader)) return 0;
+    const FileHeader *header = map;
+    if (header->magic != FILE_MAGIC || header->version != FILE_VERSION ||
+        header->nElements > INT_MAX) {
+        return 0;
+    }
+    int n = header->nElements;
+    int nBlocks = header->nBlocks;
+    if (nBlocks != (n + INT_SET_FILE_BLOCK - 1) / INT_SET_FILE_BLOCK ||
+        header->dataSize < DATA_PAD ||
+        size != sizeof(FileHeader) + (uint64_t)nBlocks*sizeof(FileBlock) +
+                header->dataSize) {
+        return 0;
+    }
+    const FileBlock *blocks = (const FileBlock *)(header + 1);
+    for (int b = 0; b < nBlocks; b++) {
+        if (blocks[b].width > 32 ||
+            blocks[b].offset + packedSize(blockCount(b, nBlocks, n),
+                                          blocks[b].width) >
+            header->dataSize - DATA_PAD) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Return a read-only MAPPED_INT_SET int-set which answers
+ *  isInIntSet(), nElementsIntSet() and iteration directly from a
+ *  mapping of the file at path written by writeIntSet(), without
+ *  decoding it up front.  It may be used as the second operand of set
+ *  operations; adding to it fails with errno EROFS.  Returns NULL on
+ *  error with errno set (EINVAL if the file is not a valid int-set
+ *  file).
+ */
+void *openIntSetMapped(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size < sizeof(FileHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  //the mapping keeps the file open
+    if (map == MAP_FAILED) return NULL;
+    Header *header = NULL;
+    if (!isValidFile(map, st.st_size)) {
+        errno = EINVAL;
+    }
+    else if ((header = calloc(1, sizeof(Header)))) {
+        const FileHeader *fileHeader = map;
+        header->backend = MAPPED_INT_SET;
+        header->nElements = fileHeader->nElements;
+        header->mapped.map = map;
+        header->mapped.mapSize = st.st_size;
+        header->mapped.blocks = (const FileBlock *)(fileHeader + 1);
+        header->mapped.nBlocks = fileHeader->nBlocks;
+        header->mapped.data =
+            (const uint8_t *)(header->mapped.blocks + fileHeader->nBlocks);
+        return header;
+    }
+    munmap(map, st.st_size);
+    return NULL;
+}
+
+/** Return a new int-set with the specified representation holding
+ *  the elements of the file at path written by writeIntSet().  Returns
+ *  NULL on error with errno set (EINVAL if the file is not a valid
+ *  int-set file).
+ */
+void *readIntSet(const char *path, IntSetBackend backend) {
+    void *mapped = openIntSetMapped(path);
+    if (!mapped) return NULL;
+    void *intSet = newBackendIntSet(backend);
+    //decode by merging the mapped set into an empty one
+    if (intSet && unionIntSet(intSet, mapped) < 0) {
+        freeIntSet(intSet);
+        intSet = NULL;
+    }
+    freeIntSet(mapped);
+    return intSet;
+}
+
+/************************** Mapped Set Access **************************/
+
+/** Return index of last block of mapped whose first element is <=
+ *  element; -1 if none.
+ */
+static int findBlock(const MappedRep *mapped, int element) {
+    int lo = 0, hi = mapped->nBlocks;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (mapped->blocks[mid].first <= element) lo = mid + 1; else hi = mid;
+    }
+    return lo - 1;
+}
+
+/** Return index within block b of header of the first element which
+ *  is >= element, setting *value to that element; the # of elements in
+ *  the block if none.
+ */
+static int scanBlock(const Header *header, int b, int element, int *value) {
+    const MappedRep *mapped = &header->mapped;
+    const FileBlock *block = &mapped->blocks[b];
+    const uint8_t *data = &mapped->data[block->offset];
+    int n = blockCount(b, mapped->nBlocks, header->nElements);
+    int i = 0;
+    for (*value = block->first; *value < element; i++) {
+        if (i == n - 1) return n;
+        *value = nextElement(*value, gapAt(data, block->width, i));
+    }
+    return i;
+}
+
+/** Return non-zero iff header contains element. */
+int isInMappedIntSet(const Header *header, int element) {
+    int b = findBlock(&header->mapped, element);
+    int value;
+    return b >= 0 &&
+        scanBlock(header, b, element, &value) <
+            blockCount(b, header->mapped.nBlocks, header->nElements) &&
+        value == element;
+}
+
+/** Return # of elements of header which are < element. */
+int rankMappedIntSet(const Header *header, int element) {
+    int b = findBlock(&header->mapped, element);
+    int value;
+    return b < 0 ? 0
+        : b*INT_SET_FILE_BLOCK + scanBlock(header, b, element, &value);
+}
+
+/** Return the element of header with rank k, 0 <= k < header->nElements. */
+int selectMappedIntSet(const Header *header, int k) {
+    const MappedRep *mapped = &header->mapped;
+    const FileBlock *block = &mapped->blocks[k / INT_SET_FILE_BLOCK];
+    const uint8_t *data = &mapped->data[block->offset];
+    int value = block->first;
+    for (int i = 0; i < k % INT_SET_FILE_BLOCK; i++) {
+        value = nextElement(value, gapAt(data, block->width, i));
+    }
+    return value;
+}
+
+/** Unmap the file of header (but do not free header itself). */
+void freeMappedIntSet(Header *header) {
+    munmap(header->mapped.map, header->mapped.mapSize);
+}
+
+/** Set iterator to the first element of header; header must not be
+ *  empty.
+ */
+void startMappedIterator(Iterator *iterator) {
+    iterator->block = 0;
+    iterator->inBlock = 0;
+    iterator->value = iterator->header->mapped.blocks[0].first;
+}
+
+/** Step iterator; return non-zero iff it was already at the last element. */
+int stepMappedIterator(Iterator *iterator) {
+    const Header *header = iterator->header;
+    const MappedRep *mapped = &header->mapped;
+    const FileBlock *block = &mapped->blocks[iterator->block];
+    int n = blockCount(iterator->block, mapped->nBlocks, header->nElements);
+    if (iterator->inBlock + 1 < n) {
+        uint32_t gap = gapAt(&mapped->data[block->offset], block->width,
+                             iterator->inBlock++);
+        iterator->value = nextElement(iterator->value, gap);
+        return 0;
+    }
+    if (iterator->block + 1 == mapped->nBlocks) return 1;
+    iterator->block++;
+    iterator->inBlock = 0;
+    iterator->value = block[1].first;
+    return 0;
+}
+
+/** Copy up to max elements from iterator to out[] and step past them.
+ *  Returns # copied, setting *isDone iff the last element was copied.
+ */
+int batchMappedIterator(Iterator *iterator, int out[], int max, int *isDone) {
+    int n = 0;
+    *isDone = 0;
+    while (n < max && !*isDone) {
+        out[n++] = iterator->value;
+        *isDone = stepMappedIterator(iterator);
+    }
+    return n;
+}
+
+/** Set iterator to the first element of header which is >= lo; return
+ *  non-zero iff there is no such element.
+ */
+int seekMappedIterator(Iterator *iterator, int lo) {
+    const Header *header = iterator->header;
+    int b = findBlock(&header->mapped, lo);
+    if (b < 0) {
+        startMappedIterator(iterator);
+        return 0;
+    }
+    int i = scanBlock(header, b, lo, &iterator->value);
+    if (i < blockCount(b, header->mapped.nBlocks, header->nElements)) {
+        iterator->block = b;
+        iterator->inBlock = i;
+        return 0;
+    }
+    //every element of block b is < lo, so the next block starts past lo
+    if (b + 1 == header->mapped.nBlocks) return 1;
+    iterator->block = b + 1;
+    iterator->inBlock = 0;
+    iterator->value = header->mapped.blocks[b + 1].first;
+    return 0;
+}
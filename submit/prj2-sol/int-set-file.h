@@ -0,0 +1,77 @@
+#ifndef INT_SET_FILE_H_
+#define INT_SET_FILE_H_
+
+#include "int-set.h"
+
+/** Binary file format for int-sets.  The sorted elements are split
+ *  into blocks of INT_SET_FILE_BLOCK elements.  Within a block each
+ *  element after the first is stored as its gap from its predecessor
+ *  (less 1), bit-packed at the smallest width which holds every gap
+ *  of the block.  A table of skip entries, giving the first element,
+ *  data offset and width of each block, precedes the packed data so
+ *  that a lookup is a binary search of the table and a scan of at most
+ *  one block.
+ *
+ *  The file is in host byte order and is meant to be read back on the
+ *  machine (or at least the architecture) which wrote it.
+ */
+
+enum { INT_SET_FILE_BLOCK = 128 };
+
+/** Write intSet (of any representation) to a new file at path.
+ *  Returns 0 on success, < 0 on error with errno set.
+ */
+int writeIntSet(void *intSet, const char *path);
+
+/** Return a new int-set with the specified representation holding
+ *  the elements of the file at path written by writeIntSet().  Returns
+ *  NULL on error with errno set (EINVAL if the file is not a valid
+ *  int-set file).
+ */
+void *readIntSet(const char *path, IntSetBackend backend);
+
+/** Return a read-only MAPPED_INT_SET int-set which answers
+ *  isInIntSet(), nElementsIntSet() and iteration directly from a
+ *  mapping of the file at path written by writeIntSet(), without
+ *  decoding it up front.  It may be used as the second operand of set
+ *  operations; adding to it fails with errno EROFS.  Returns NULL on
+ *  error with errno set (EINVAL if the file is not a valid int-set
+ *  file).
+ */
+void *openIntSetMapped(const char *path);
+
+/** Routines for MAPPED_INT_SET called by the int-set.c entry points
+ *  after dispatching on header->backend.
+ */
+
+/** Return non-zero iff header contains element. */
+int isInMappedIntSet(const Header *header, int element);
+
+/** Return # of elements of header which are < element. */
+int rankMappedIntSet(const Header *header, int element);
+
+/** Return the element of header with rank k, 0 <= k < header->nElements. */
+int selectMappedIntSet(const Header *header, int k);
+
+/** Unmap the file of header (but do not free header itself). */
+void freeMappedIntSet(Header *header);
+
+/** Set iterator to the first element of header; header must not be
+ *  empty.
+ */
+void startMappedIterator(Iterator *iterator);
+
+/** Step iterator; return non-zero iff it was already at the last element. */
+int stepMappedIterator(Iterator *iterator);
+
+/** Copy up to max elements from iterator to out[] and step past them.
+ *  Returns # copied, setting *isDone iff the last element was copied.
+ */
+int batchMappedIterator(Iterator *iterator, int out[], int max, int *isDone);
+
+/** Set iterator to the first element of header which is >= lo; return
+ *  non-zero iff there is no such element.
+ */
+int seekMappedIterator(Iterator *iterator, int lo);
+
+#endif //ifndef INT_SET_FILE_H_
@@ -0,0 +1,287 @@
+#include "int-set-hash.h"
+#include "int-sort.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+enum {
+    GROUP = 16,             //# of slots whose control bytes are probed at once
+    EMPTY = -128,           //control byte of an empty slot; tags are >= 0
+    MIN_HASH_CAPACITY = 16, //# of slots in a non-empty table, at least
+    BATCH = 256             //# of elements taken from an iterator at once
+};
+
+/** Return hash of element: bits 0-6 tag its slot, the rest choose the
+ *  group where probing starts.  The multiply spreads each input bit
+ *  upward; folding in the high half lets the low bits see them all.
+ */
+static inline uint64_t hashOf(int element) {
+    uint64_t h = (uint64_t)(uint32_t)element * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+static inline int8_t tagOf(uint64_t h) {
+    return h & 0x7F;
+}
+
+/** Return mask with bit i set iff group[i] == byte, for i < GROUP */
+static inline unsigned matchGroup(const int8_t group[], int8_t byte) {
+#if defined(__SSE2__)
+    __m128i control = _mm_loadu_si128((const __m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(byte)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < GROUP; i++) mask |= (unsigned)(group[i] == byte) << i;
+    return mask;
+#endif
+}
+
+/** Return index of the slot of hash holding element if any, else
+ *  -1 - the index of the empty slot where it would go.  hash must
+ *  have a non-zero capacity and at least one empty slot.
+ */
+static int findSlot(const HashRep *hash, int element) {
+    uint64_t h = hashOf(element);
+    int8_t tag = tagOf(h);
+    int groupMask = hash->capacity / GROUP - 1;
+    int g = (h >> 7) & groupMask;
+    //triangular steps visit every group of a power-of-2 table
+    for (int step = 1; ; step++) {
+        const int8_t *group = &hash->control[g * GROUP];
+        for (unsigned m = matchGroup(group, tag); m != 0; m &= m - 1) {
+            int i = g*GROUP + __builtin_ctz(m);
+            if (hash->slots[i] == element) return i;
+        }
+        //no removals, so an empty slot ends every probe sequence
+        unsigned empty = matchGroup(group, EMPTY);
+        if (empty != 0) return -1 - (g*GROUP + __builtin_ctz(empty));
+        g = (g + step) & groupMask;
+    }
+}
+
+/** Put element, which must not be in hash, into its slot */
+static void placeElement(HashRep *hash, int element) {
+    int i = -1 - findSlot(hash, element);
+    hash->control[i] = tagOf(hashOf(element));
+    hash->slots[i] = element;
+}
+
+/** Discard the sorted copy of hash; called on every change. */
+static void invalidateSorted(HashRep *hash) {
+    free(hash->sorted);
+    hash->sorted = NULL;
+}
+
+/** Ensure hash can hold n elements with at most 7/8 of its slots in
+ *  use, rehashing into a larger table if needed.  Returns 1 if it
+ *  rehashed, 0 if not, < 0 on error with errno set.
+ */
+static int reserveHash(HashRep *hash, int n) {
+    if ((long)n * 8 <= (long)hash->capacity * 7) return 0;
+    long capacity = hash->capacity ? hash->capacity : MIN_HASH_CAPACITY;
+    while (capacity * 7 < (long)n * 8) capacity *= 2;
+    if (capacity > (1L << 30)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    HashRep bigger = {
+        .control = malloc(capacity),
+        .slots = malloc(capacity * sizeof(int)),
+        .capacity = capacity,
+    };
+    if (!bigger.control || !bigger.slots) {
+        free(bigger.control);
+        free(bigger.slots);
+        return -1;
+    }
+    memset(bigger.control, EMPTY, capacity);
+    for (int i = 0; i < hash->capacity; i++) {
+        if (hash->control[i] != EMPTY) placeElement(&bigger, hash->slots[i]);
+    }
+    free(hash->control);
+    free(hash->slots);
+    hash->control = bigger.control;
+    hash->slots = bigger.slots;
+    hash->capacity = capacity;
+    return 1;
+}
+
+/** Add element to header.  Returns 1 if added, 0 if already present,
+ *  < 0 on error.
+ */
+static int insertElement(Header *header, int element) {
+    HashRep *hash = &header->hash;
+    int i = hash->capacity > 0 ? findSlot(hash, element) : -1;
+    if (i >= 0) return 0;
+    int rehashed = reserveHash(hash, header->nElements + 1);
+    if (rehashed < 0) return -1;
+    if (rehashed) i = findSlot(hash, element);
+    i = -1 - i;
+    hash->control[i] = tagOf(hashOf(element));
+    hash->slots[i] = element;
+    header->nElements++;
+    invalidateSorted(hash);
+    return 1;
+}
+
+/** Return non-zero iff header contains element. */
+int isInHashIntSet(const Header *header, int element) {
+    return header->hash.capacity > 0 && findSlot(&header->hash, element) >= 0;
+}
+
+/** Add element to header.  Returns # of elements after addition,
+ *  < 0 on error with errno set.
+ */
+int addHashIntSet(Header *header, int element) {
+    return insertElement(header, element) < 0 ? -1 : header->nElements;
+}
+
+/** Add elements[n] (in any order, possibly repeated) to header.
+ *  Returns # of elements after addition, < 0 on error with errno set.
+ */
+int addManyHashIntSet(Header *header, const int elements[], int n) {
+    //size for the worst case once rather than growing repeatedly
+    if (n > 0 && reserveHash(&header->hash, header->nElements + n) < 0) return -1;
+    for (int i = 0; i < n; i++) {
+        if (insertElement(header, elements[i]) < 0) return -1;
+    }
+    return header->nElements;
+}
+
+/** Make the empty header hold sorted[n], which must be strictly
+ *  increasing and allocated by malloc(); header takes it over as its
+ *  sorted copy.  Returns 0 on success, < 0 on error with errno set
+ *  (sorted not taken over).
+ */
+int adoptSortedHashIntSet(Header *header, int *sorted, int n) {
+    HashRep *hash = &header->hash;
+    if (reserveHash(hash, n) < 0) return -1;
+    for (int i = 0; i < n; i++) placeElement(hash, sorted[i]);
+    header->nElements = n;
+    hash->sorted = sorted;
+    return 0;
+}
+
+/** Set header to its union with intSetB (of any representation).
+ *  Returns # of elements after union, < 0 on error with errno set.
+ */
+int unionHashIntSet(Header *header, const void *intSetB) {
+    if (intSetB == header) return header->nElements;
+    int nB = nElementsIntSet((void *)intSetB);
+    if (reserveHash(&header->hash, header->nElements > nB ? header->nElements : nB) < 0) {
+        return -1;
+    }
+    int batch[BATCH];
+    const void *iter = newIntSetIterator(intSetB);
+    //NULL for an empty B, but also if iteration could not be started
+    if (!iter && nB > 0) return -1;
+    for (int n; (n = nextBatchIntSet(&iter, batch, BATCH)) > 0; ) {
+        for (int i = 0; i < n; i++) {
+            if (insertElement(header, batch[i]) < 0) {
+                freeIntSetIterator(iter);
+                return -1;
+            }
+        }
+    }
+    return header->nElements;
+}
+
+/** Set header to its intersection with intSetB (of any
+ *  representation).  Returns # of elements after intersection, < 0
+ *  on error with errno set.
+ */
+int intersectionHashIntSet(Header *header, const void *intSetB) {
+    if (intSetB == header) return header->nElements;
+    HashRep *hash = &header->hash;
+    int n = header->nElements;
+    //merge the sorted elements against B, which iterates in order
+    const int *sorted = sortedHashIntSet(header);
+    int *kept = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!sorted || !kept) {
+        free(kept);
+        return -1;
+    }
+    int nKept = 0, iA = 0;
+    int batch[BATCH];
+    const void *iter = newIntSetIterator(intSetB);
+    if (!iter && nElementsIntSet((void *)intSetB) > 0) {
+        free(kept);
+        return -1;
+    }
+    for (int nBatch; iA < n && (nBatch = nextBatchIntSet(&iter, batch, BATCH)) > 0; ) {
+        for (int i = 0; i < nBatch && iA < n; i++) {
+            while (iA < n && sorted[iA] < batch[i]) iA++;
+            if (iA < n && sorted[iA] == batch[i]) kept[nKept++] = sorted[iA++];
+        }
+    }
+    freeIntSetIterator(iter);
+    //without removal, rebuild the table in place; kept stays sorted
+    if (hash->capacity > 0) memset(hash->control, EMPTY, hash->capacity);
+    for (int i = 0; i < nKept; i++) placeElement(hash, kept[i]);
+    free(hash->sorted);
+    hash->sorted = kept;
+    return header->nElements = nKept;
+}
+
+/** Return the elements of header in increasing order, sorting them
+ *  if they have changed since last asked.  The array belongs to
+ *  header and is valid until header is next changed.  Returns NULL on
+ *  error with errno set.
+ */
+const int *sortedHashIntSet(Header *header) {
+    HashRep *hash = &header->hash;
+    if (hash->sorted) return hash->sorted;
+    int n = header->nElements;
+    int *sorted = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!sorted) return NULL;
+    int k = 0;
+    for (int i = 0; i < hash->capacity; i++) {
+        if (hash->control[i] != EMPTY) sorted[k++] = hash->slots[i];
+    }
+    if (sortUniqueInts(sorted, n) < 0) {
+        free(sorted);
+        return NULL;
+    }
+    return hash->sorted = sorted;
+}
+
+/** Return # of elements of header which are < element. */
+int rankHashIntSet(Header *header, int element) {
+    const int *sorted = sortedHashIntSet(header);
+    int rank = 0;
+    if (sorted) {
+        int hi = header->nElements;
+        while (rank < hi) {
+            int mid = rank + (hi - rank)/2;
+            if (sorted[mid] < element) rank = mid + 1; else hi = mid;
+        }
+    }
+    else { //no memory to sort: count directly
+        for (int i = 0; i < header->hash.capacity; i++) {
+            rank += header->hash.control[i] != EMPTY && header->hash.slots[i] < element;
+        }
+    }
+    return rank;
+}
+
+/** Return # of bytes allocated for the table of header, including its
+ *  ordered copy if built.
+ */
+size_t memoryUsageHashIntSet(const Header *header) {
+    const HashRep *hash = &header->hash;
+    size_t size = hash->capacity * (sizeof(int8_t) + sizeof(int));
+    if (hash->sorted) size += header->nElements * sizeof(int);
+    return size;
+}
+
+/** Free the table of header (but not header itself). */
+void freeHashIntSet(Header *header) {
+    free(header->hash.control);
+    free(header->hash.slots);
+    free(header->hash.sorted);
+}
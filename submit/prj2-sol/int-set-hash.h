@@ -0,0 +1,68 @@
+#ifndef INT_SET_HASH_H_
+#define INT_SET_HASH_H_
+
+#include "int-set.h"
+
+/** Open-addressing hash representation for int-sets (HASH_INT_SET),
+ *  in the style of a Swiss table: slots are probed a group of 16 at a
+ *  time by comparing a byte of control data per slot (a 7-bit tag of
+ *  the element's hash, or empty) against the sought tag with one SIMD
+ *  compare, so membership is O(1) expected.  Elements are kept in no
+ *  particular order; a sorted copy is built on the first ordered
+ *  access (iteration, order queries, set algebra) after a change.
+ *
+ *  These routines are called by the int-set.c entry points after
+ *  dispatching on header->backend; they all require
+ *  header->backend == HASH_INT_SET.
+ */
+
+/** Return non-zero iff header contains element. */
+int isInHashIntSet(const Header *header, int element);
+
+/** Add element to header.  Returns # of elements after addition,
+ *  < 0 on error with errno set.
+ */
+int addHashIntSet(Header *header, int element);
+
+/** Add elements[n] (in any order, possibly repeated) to header.
+ *  Returns # of elements after addition, < 0 on error with errno set.
+ */
+int addManyHashIntSet(Header *header, const int elements[], int n);
+
+/** Make the empty header hold sorted[n], which must be strictly
+ *  increasing and allocated by malloc(); header takes it over as its
+ *  sorted copy.  Returns 0 on success, < 0 on error with errno set
+ *  (sorted not taken over).
+ */
+int adoptSortedHashIntSet(Header *header, int *sorted, int n);
+
+/** Set header to its union with intSetB (of any representation).
+ *  Returns # of elements after union, < 0 on error with errno set.
+ */
+int unionHashIntSet(Header *header, const void *intSetB);
+
+/** Set header to its intersection with intSetB (of any
+ *  representation).  Returns # of elements after intersection, < 0
+ *  on error with errno set.
+ */
+int intersectionHashIntSet(Header *header, const void *intSetB);
+
+/** Return the elements of header in increasing order, sorting them
+ *  if they have changed since last asked.  The array belongs to
+ *  header and is valid until header is next changed.  Returns NULL on
+ *  error with errno set.
+ */
+const int *sortedHashIntSet(Header *header);
+
+/** Return # of elements of header which are < element. */
+int rankHashIntSet(Header *header, int element);
+
+/** Return # of bytes allocated for the table of header, including its
+ *  ordered copy if built.
+ */
+size_t memoryUsageHashIntSet(const Header *header);
+
+/** Free the table of header (but not header itself). */
+void freeHashIntSet(Header *header);
+
+#endif //ifndef INT_SET_HASH_H_
@@ -0,0 +1,403 @@
+#define _POSIX_C_SOURCE 200809L  //for sysconf() under -std=c18
+
+#include "int-set-parallel.h"
+#include "int-set.h"
+#include "int-set-bitmap.h"
+#include "int-set-hash.h"
+#include "int-merge.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+    PARALLEL_MIN = 1 << 17,  //fewer input elements are merged sequentially
+    MIN_PART = 1 << 14,      //fewest input elements worth a part
+    PARTS_PER_THREAD = 4,    //extra parts even out the time per thread
+    MAX_THREADS = 256,
+    N_CHUNKS = 1 << 16       //# of chunks of 2**16 values in the int range
+};
+
+typedef enum {
+    PARALLEL_UNION,
+    PARALLEL_INTERSECTION,
+    PARALLEL_DIFFERENCE
+} ParallelOp;
+
+/***************************** Thread Pool *****************************/
+
+/** Task i of a job run by a Pool */
+typedef void Task(void *context, int i);
+
+typedef struct { //threads which share the tasks of one job at a time
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  //a job has been posted or the pool is closing
+    pthread_cond_t idle;  //the last worker has finished the current job
+    Task *task;           //current job: task(context, i), 0 <= i < nTasks
+    void *context;
+    int nTasks;
+    atomic_int next;      //next task of the current job to be claimed
+    unsigned job;         //# of jobs posted
+    int nRunning;         //# of workers still on the current job
+    int isClosing;
+    int nWorkers;         //# of threads started
+    pthread_t workers[];
+} Pool;
+
+/** Claim and run tasks of the current job of pool until none are left */
+static void runTasks(Pool *pool) {
+    for (int i; (i = atomic_fetch_add(&pool->next, 1)) < pool->nTasks; ) {
+        pool->task(pool->context, i);
+    }
+}
+
+static void *workerMain(void *arg) {
+    Pool *pool = arg;
+    unsigned seen = 0; //last job run
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->isClosing && pool->job == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->isClosing) break;
+        seen = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+        runTasks(pool);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->nRunning == 0) pthread_cond_signal(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/** Return a new pool which, with the calling thread, has nThreads
+ *  threads; fewer if threads cannot be started.  Returns NULL on error
+ *  with errno set.
+ */
+static Pool *newPool(int nThreads) {
+    Pool *pool = malloc(sizeof(Pool) + (nThreads - 1) * sizeof(pthread_t));
+    if (!pool) return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    atomic_init(&pool->next, 0);
+    pool->nTasks = pool->nRunning = pool->isClosing = pool->nWorkers = 0;
+    pool->job = 0;
+    //the caller runs tasks too, so a short pool only costs speed
+    while (pool->nWorkers < nThreads - 1 &&
+           pthread_create(&pool->workers[pool->nWorkers], NULL, workerMain,
+                          pool) == 0) {
+        pool->nWorkers++;
+    }
+    return pool;
+}
+
+/** Run task(context, i) for 0 <= i < nTasks on the threads of pool,
+ *  including the caller, and return once all have finished.
+ */
+static void runJob(Pool *pool, Task *task, void *context, int nTasks) {
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->nTasks = nTasks;
+    atomic_store(&pool->next, 0);
+    pool->nRunning = pool->nWorkers;
+    pool->job++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    runTasks(pool);
+    pthread_mutex_lock(&pool->lock);
+    while (pool->nRunning > 0) pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void freePool(Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->isClosing = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nWorkers; i++) pthread_join(pool->workers[i], NULL);
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+/*************************** Partitioned Merge *************************/
+
+typedef struct { //values [lo, lo of next part), merged as one task
+    long lo;           //first value of part; a chunk boundary
+    int rankA, rankB;  //# of elements of A, B which are < lo
+    size_t outOffset;  //start of part's output in Merge.scratch
+    int nOut;          //# of elements output; < 0 on error
+    int err;           //errno on error
+    size_t resultOffset; //start of part's output in Merge.result
+    Header *bitmap;    //BITMAP_INT_SET result: output of part
+} Part;
+
+typedef struct { //shared by the tasks of a parallel set operation
+    ParallelOp op;
+    Header *a, *b;
+    IntSetBackend backend; //of result
+    Part *parts;           //parts[nParts + 1]; last only bounds the others
+    int nParts;
+    int *scratch;          //output of each part at its outOffset
+    int *result;           //outputs of all parts concatenated
+} Merge;
+
+/** Return first value of chunk c, 0 <= c <= N_CHUNKS */
+static long chunkStart(int c) {
+    return ((long)c - N_CHUNKS/2) * N_CHUNKS;
+}
+
+/** Return # of elements of header < v, for v up to INT_MAX + 1 */
+static int rankOf(Header *header, long v) {
+    return (v > INT_MAX) ? header->nElements : rankIntSet(header, (int)v);
+}
+
+/** Set *lo, *rankA and *rankB of part to the first chunk boundary
+ *  before which a and b together have at least target elements.
+ */
+static void findSplitter(Header *a, Header *b, long target, Part *part) {
+    int lo = 0, hi = N_CHUNKS;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        long v = chunkStart(mid);
+        if ((long)rankOf(a, v) + rankOf(b, v) >= target) hi = mid; else lo = mid + 1;
+    }
+    part->lo = chunkStart(lo);
+    part->rankA = rankOf(a, part->lo);
+    part->rankB = rankOf(b, part->lo);
+}
+
+/** Return the max # of elements op can output from nA and nB inputs */
+static long outputBound(ParallelOp op, int nA, int nB) {
+    return (op == PARALLEL_UNION) ? (long)nA + nB
+        : (op == PARALLEL_INTERSECTION) ? (nA < nB ? nA : nB)
+        : nA;
+}
+
+/** Return the n elements of header from rank onwards, the first of
+ *  which is >= lo: directly for sorted representations, else decoded
+ *  into a copy also returned in *copy for the caller to free().
+ *  Returns NULL on error with errno set.
+ */
+static const int *sliceOf(const Header *header, long lo, int rank, int n,
+                          int **copy) {
+    static const int none[1];
+    *copy = NULL;
+    if (n == 0) return none;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        return &header->array.elements[rank];
+    case HASH_INT_SET:
+        return &header->hash.sorted[rank];
+    default:
+        break;
+    }
+    if (!(*copy = malloc(n * sizeof(int)))) return NULL;
+    const void *iter = newIntSetIteratorFrom(header, (int)lo);
+    int nCopied = nextBatchIntSet(&iter, *copy, n);
+    freeIntSetIterator(iter);
+    if (nCopied < n) {
+        free(*copy);
+        *copy = NULL;
+        errno = ENOMEM; //iterator allocation failed
+        return NULL;
+    }
+    return *copy;
+}
+
+/** Task: merge part i of context into its place in scratch and, for a
+ *  BITMAP_INT_SET result, build its chunks.
+ */
+static void mergePart(void *context, int i) {
+    Merge *merge = context;
+    Part *part = &merge->parts[i];
+    const Part *end = part + 1;
+    int nA = end->rankA - part->rankA, nB = end->rankB - part->rankB;
+    int *copyA, *copyB = NULL;
+    const int *a = sliceOf(merge->a, part->lo, part->rankA, nA, &copyA);
+    const int *b = a ? sliceOf(merge->b, part->lo, part->rankB, nB, &copyB) : NULL;
+    int *out = &merge->scratch[part->outOffset];
+    part->nOut = -1;
+    if (a && b) {
+        switch (merge->op) {
+        case PARALLEL_UNION:
+            part->nOut = unionSortedInts(a, nA, b, nB, out);
+            break;
+        case PARALLEL_INTERSECTION:
+            part->nOut = intersectSortedInts(a, nA, b, nB, out);
+            break;
+        default:
+            part->nOut = differenceSortedInts(a, nA, b, nB, out);
+        }
+    }
+    if (part->nOut > 0 && merge->backend == BITMAP_INT_SET) {
+        if (!(part->bitmap = newBackendIntSet(BITMAP_INT_SET)) ||
+            addSortedBitmapIntSet(part->bitmap, out, part->nOut) < 0) {
+            part->nOut = -1;
+        }
+        else {
+            runOptimizeBitmapIntSet(part->bitmap);
+        }
+    }
+    if (part->nOut < 0) part->err = errno;
+    free(copyA);
+    free(copyB);
+}
+
+/** Task: copy the output of part i of context into result */
+static void copyPart(void *context, int i) {
+    Merge *merge = context;
+    const Part *part = &merge->parts[i];
+    memcpy(&merge->result[part->resultOffset], &merge->scratch[part->outOffset],
+           part->nOut * sizeof(int));
+}
+
+/** Return non-zero iff header can be read from several threads at
+ *  once, bringing its order index up to date if need be.
+ */
+static int prepareOperand(Header *header) {
+    switch (header->backend) {
+    case HASH_INT_SET:
+        return sortedHashIntSet(header) != NULL;
+    case BITMAP_INT_SET:
+        rankBitmapIntSet(header, 0);
+        return 1;
+    default:
+        return 1;
+    }
+}
+
+/** Return op applied to intSetA and intSetB by the sequential routine */
+static void *sequentialSetOp(ParallelOp op, void *intSetA, void *intSetB) {
+    switch (op) {
+    case PARALLEL_UNION:
+        return newUnionIntSet(intSetA, intSetB);
+    case PARALLEL_INTERSECTION:
+        return newIntersectionIntSet(intSetA, intSetB);
+    default:
+        return newDifferenceIntSet(intSetA, intSetB);
+    }
+}
+
+/** Return the outputs of the parts of merge, which must all have
+ *  succeeded, as one new set.  Returns NULL on error with errno set.
+ */
+static void *gatherParts(Merge *merge, Pool *pool) {
+    size_t nResult = 0;
+    for (int i = 0; i < merge->nParts; i++) {
+        merge->parts[i].resultOffset = nResult;
+        nResult += merge->parts[i].nOut;
+    }
+    if (nResult > INT_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    if (merge->backend == BITMAP_INT_SET) {
+        //parts end on chunk boundaries, so their chunks just concatenate
+        Header *result = newBackendIntSet(BITMAP_INT_SET);
+        for (int i = 0; result && i < merge->nParts; i++) {
+            if (merge->parts[i].bitmap &&
+                appendBitmapIntSet(result, merge->parts[i].bitmap) < 0) {
+                freeIntSet(result);
+                result = NULL;
+            }
+        }
+        return result;
+    }
+    if (!(merge->result = malloc((nResult > 0 ? nResult : 1) * sizeof(int)))) {
+        return NULL;
+    }
+    runJob(pool, copyPart, merge, merge->nParts);
+    int *result = merge->result;
+    merge->result = NULL;
+    return newSortedIntSet(merge->backend, result, nResult, nResult);
+}
+
+/** Return a new set, with the representation of intSetA, containing
+ *  the result of op on intSetA and intSetB, computed by nThreads
+ *  threads.  Returns NULL on error with errno set.
+ */
+static void *newParallelSetOp(ParallelOp op, void *intSetA, void *intSetB,
+                              int nThreads) {
+    if (nThreads < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (nThreads == 0) {
+        long nProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+        nThreads = (nProcessors > 0) ? nProcessors : 1;
+    }
+    if (nThreads > MAX_THREADS) nThreads = MAX_THREADS;
+    Merge merge = { .op = op, .a = intSetA, .b = intSetB,
+                    .backend = ((Header *)intSetA)->backend };
+    long nInputs = (long)merge.a->nElements + merge.b->nElements;
+    if (nThreads == 1 || nInputs < PARALLEL_MIN) {
+        return sequentialSetOp(op, intSetA, intSetB);
+    }
+    if (!prepareOperand(merge.a) || !prepareOperand(merge.b)) return NULL;
+
+    //split the inputs evenly between the parts by their total ranks
+    merge.nParts = nThreads * PARTS_PER_THREAD;
+    if (merge.nParts > nInputs / MIN_PART) merge.nParts = nInputs / MIN_PART;
+    if (!(merge.parts = calloc(merge.nParts + 1, sizeof(Part)))) return NULL;
+    size_t nScratch = 0;
+    for (int i = 0; i <= merge.nParts; i++) {
+        Part *part = &merge.parts[i];
+        findSplitter(merge.a, merge.b, nInputs * i / merge.nParts, part);
+        if (i > 0) {
+            Part *prev = part - 1;
+            prev->outOffset = nScratch;
+            nScratch += outputBound(op, part->rankA - prev->rankA,
+                                    part->rankB - prev->rankB);
+        }
+    }
+    void *result = NULL;
+    Pool *pool = NULL;
+    if ((merge.scratch = malloc((nScratch > 0 ? nScratch : 1) * sizeof(int))) &&
+        (pool = newPool(nThreads < merge.nParts ? nThreads : merge.nParts))) {
+        runJob(pool, mergePart, &merge, merge.nParts);
+        int err = 0;
+        for (int i = 0; i < merge.nParts && !err; i++) {
+            if (merge.parts[i].nOut < 0) err = merge.parts[i].err;
+        }
+        if (err) {
+            errno = err;
+        }
+        else {
+            result = gatherParts(&merge, pool);
+        }
+    }
+    if (pool) freePool(pool);
+    for (int i = 0; i < merge.nParts; i++) {
+        if (merge.parts[i].bitmap) freeIntSet(merge.parts[i].bitmap);
+    }
+    free(merge.scratch);
+    free(merge.parts);
+    return result;
+}
+
+/** Return a new int-set containing the union of intSetA and intSetB. */
+void *newParallelUnionIntSet(void *intSetA, void *intSetB, int nThreads) {
+    return newParallelSetOp(PARALLEL_UNION, intSetA, intSetB, nThreads);
+}
+
+/** Return a new int-set containing the intersection of intSetA and
+ *  intSetB.
+ */
+void *newParallelIntersectionIntSet(void *intSetA, void *intSetB, int nThreads) {
+    return newParallelSetOp(PARALLEL_INTERSECTION, intSetA, intSetB, nThreads);
+}
+
+/** Return a new int-set containing the elements of intSetA which are
+ *  not in intSetB.
+ */
+void *newParallelDifferenceIntSet(void *intSetA, void *intSetB, int nThreads) {
+    return newParallelSetOp(PARALLEL_DIFFERENCE, intSetA, intSetB, nThreads);
+}
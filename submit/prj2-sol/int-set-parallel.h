@@ -0,0 +1,42 @@
+#ifndef INT_SET_PARALLEL_H_
+#define INT_SET_PARALLEL_H_
+
+/** Set operations on large int-sets spread over several threads.  The
+ *  value range is cut into parts holding about equal numbers of input
+ *  elements, found by binary search of rankIntSet() over the 2**16
+ *  chunk boundaries; the parts are merged by a pool of threads and
+ *  their results concatenated in value order.  Every part ends on a
+ *  chunk boundary, so a BITMAP_INT_SET result is assembled from
+ *  chunks built in parallel.
+ *
+ *  The operands may use any representation, but only those which
+ *  seek in O(log n) (see rankIntSet()) gain from parallelism: ARRAY
+ *  and HASH operands are merged in place and BITMAP and MAPPED
+ *  operands are decoded part by part.  Operands are only read, so the
+ *  same set may be used by several calls at once provided nothing
+ *  changes it; a HASH_INT_SET or BITMAP_INT_SET operand first has its
+ *  order index brought up to date by the calling thread.
+ *
+ *  Each result is identical to that of the corresponding sequential
+ *  newXxxIntSet() of int-set.h, whatever the # of threads, and has
+ *  the representation of intSetA.  nThreads is the # of threads to
+ *  use, counting the caller; 0 for one per online processor.  Small
+ *  operands, or nThreads == 1, use the sequential routine.  Returns
+ *  NULL on error with errno set (EINVAL if nThreads < 0, EOVERFLOW if
+ *  a union would exceed INT_MAX elements).
+ */
+
+/** Return a new int-set containing the union of intSetA and intSetB. */
+void *newParallelUnionIntSet(void *intSetA, void *intSetB, int nThreads);
+
+/** Return a new int-set containing the intersection of intSetA and
+ *  intSetB.
+ */
+void *newParallelIntersectionIntSet(void *intSetA, void *intSetB, int nThreads);
+
+/** Return a new int-set containing the elements of intSetA which are
+ *  not in intSetB.
+ */
+void *newParallelDifferenceIntSet(void *intSetA, void *intSetB, int nThreads);
+
+#endif //ifndef INT_SET_PARALLEL_H_
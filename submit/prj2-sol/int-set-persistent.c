@@ -0,0 +1,320 @@
+#include "int-set-persistent.h"
+#include "int-set.h"
+#include "int-merge.h"
+#include "int-sort.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    LEAF_MAX = 64,   //most keys in a leaf
+    BRANCH_MAX = 32  //most children of a branch
+};
+
+typedef struct PersistentNode { //immutable once built
+    atomic_int refs;   //# of versions and parent branches using node
+    int isLeaf;
+    int n;             //# of keys of a leaf, of children of a branch
+    int nElements;     //# of elements under node
+    union {
+        int keys[LEAF_MAX]; //leaf: keys[n], strictly increasing
+        struct {            //branch
+            int firsts[BRANCH_MAX]; //firsts[i]: least element under children[i]
+            struct PersistentNode *children[BRANCH_MAX];
+        };
+    };
+} PNode;
+
+/** Return a new leaf or branch node with one reference.  Returns NULL
+ *  on error.
+ */
+static PNode *newNode(int isLeaf) {
+    PNode *node = malloc(sizeof(PNode));
+    if (!node) return NULL;
+    atomic_init(&node->refs, 1);
+    node->isLeaf = isLeaf;
+    node->n = node->nElements = 0;
+    return node;
+}
+
+static void retainNode(const PNode *node) {
+    atomic_fetch_add(&((PNode *)node)->refs, 1);
+}
+
+/** Drop a reference to node, freeing it and releasing its children
+ *  when it was the last.
+ */
+static void releaseNode(PNode *node) {
+    if (atomic_fetch_sub(&node->refs, 1) != 1) return;
+    if (!node->isLeaf) {
+        for (int i = 0; i < node->n; i++) releaseNode(node->children[i]);
+    }
+    free(node);
+}
+
+/** Return least element under node, which must not be empty */
+static int firstOf(const PNode *node) {
+    return node->isLeaf ? node->keys[0] : node->firsts[0];
+}
+
+/** Return index of first of keys[n] which is >= element; n if none */
+static int lowerBound(const int keys[], int n, int element) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (keys[mid] < element) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/** Return index of the child of branch whose range holds element */
+static int childIndex(const PNode *branch, int element) {
+    int i = lowerBound(branch->firsts, branch->n, element);
+    if (i < branch->n && branch->firsts[i] == element) return i;
+    return i > 0 ? i - 1 : 0;
+}
+
+/** Set out[] to leaves holding keys[n], 0 < n <= 2 * LEAF_MAX, split in
+ *  two if they do not fit one.  Returns # of leaves, < 0 on error.
+ */
+static int makeLeaves(const int keys[], int n, PNode *out[2]) {
+    int nOut = (n > LEAF_MAX) ? 2 : 1;
+    for (int j = 0, start = 0; j < nOut; j++) {
+        int end = (j == nOut - 1) ? n : n/2;
+        if (!(out[j] = newNode(1))) {
+            if (j > 0) releaseNode(out[0]);
+            return -1;
+        }
+        out[j]->n = out[j]->nElements = end - start;
+        memcpy(out[j]->keys, &keys[start], (end - start) * sizeof(int));
+        start = end;
+    }
+    return nOut;
+}
+
+/** Set out[] to branches over children[n], 0 < n <= 2 * BRANCH_MAX,
+ *  whose references they take over, split in two if they do not fit
+ *  one.  Returns # of branches, < 0 on error (references untouched).
+ */
+static int makeBranches(PNode *children[], int n, PNode *out[2]) {
+    int nOut = (n > BRANCH_MAX) ? 2 : 1;
+    for (int j = 0, start = 0; j < nOut; j++) {
+        int end = (j == nOut - 1) ? n : n/2;
+        if (!(out[j] = newNode(0))) {
+            if (j > 0) free(out[0]); //not yet holding its children
+            return -1;
+        }
+        out[j]->n = end - start;
+        for (int i = start; i < end; i++) {
+            out[j]->children[i - start] = children[i];
+            out[j]->firsts[i - start] = firstOf(children[i]);
+            out[j]->nElements += children[i]->nElements;
+        }
+        start = end;
+    }
+    return nOut;
+}
+
+/** Set out[] to copies of node with element, which it must not
+ *  contain, added: one node, or two if node had to split.  Only the
+ *  path to element is copied; the copies share all other nodes.
+ *  Returns # of nodes, < 0 on error.
+ */
+static int insertNode(const PNode *node, int element, PNode *out[2]) {
+    if (node->isLeaf) {
+        int keys[LEAF_MAX + 1];
+        int i = lowerBound(node->keys, node->n, element);
+        memcpy(keys, node->keys, i * sizeof(int));
+        keys[i] = element;
+        memcpy(&keys[i + 1], &node->keys[i], (node->n - i) * sizeof(int));
+        return makeLeaves(keys, node->n + 1, out);
+    }
+    int i = childIndex(node, element);
+    PNode *copies[2];
+    int nCopies = insertNode(node->children[i], element, copies);
+    if (nCopies < 0) return -1;
+    PNode *children[BRANCH_MAX + 1];
+    memcpy(children, node->children, i * sizeof(PNode *));
+    memcpy(&children[i], copies, nCopies * sizeof(PNode *));
+    memcpy(&children[i + nCopies], &node->children[i + 1],
+           (node->n - i - 1) * sizeof(PNode *));
+    int nOut = makeBranches(children, node->n - 1 + nCopies, out);
+    if (nOut < 0) {
+        for (int j = 0; j < nCopies; j++) releaseNode(copies[j]);
+        return -1;
+    }
+    for (int j = 0; j < node->n; j++) {
+        if (j != i) retainNode(node->children[j]);
+    }
+    return nOut;
+}
+
+/** Return a new version holding sorted[n], which must be strictly
+ *  increasing, with full nodes built bottom up.  Returns NULL on error.
+ */
+static PNode *buildVersion(const int sorted[], int n) {
+    if (n == 0) return newNode(1);
+    int nNodes = (n + LEAF_MAX - 1) / LEAF_MAX;
+    PNode **level = malloc(nNodes * sizeof(PNode *));
+    if (!level) return NULL;
+    int isOk = 1;
+    int nBuilt = 0; //# of nodes of level which hold a reference
+    while (isOk && nBuilt < nNodes) {
+        int start = nBuilt * LEAF_MAX;
+        int end = (start + LEAF_MAX < n) ? start + LEAF_MAX : n;
+        PNode *out[2];
+        isOk = makeLeaves(&sorted[start], end - start, out) == 1;
+        if (isOk) level[nBuilt++] = out[0];
+    }
+    while (isOk && nNodes > 1) {
+        //each group of up to BRANCH_MAX nodes becomes one branch
+        int nParents = (nNodes + BRANCH_MAX - 1) / BRANCH_MAX;
+        for (int p = 0; isOk && p < nParents; p++) {
+            int start = p * BRANCH_MAX;
+            int end = (start + BRANCH_MAX < nNodes) ? start + BRANCH_MAX : nNodes;
+            PNode *out[2];
+            isOk = makeBranches(&level[start], end - start, out) == 1;
+            if (isOk) {
+                level[p] = out[0];
+                nBuilt = p + 1;
+            }
+            else {
+                //parents so far hold level[0, start); release the rest
+                for (int i = start; i < nNodes; i++) releaseNode(level[i]);
+                nBuilt = p;
+            }
+        }
+        nNodes = nParents;
+    }
+    PNode *root = isOk ? level[0] : NULL;
+    if (!isOk) {
+        for (int i = 0; i < nBuilt; i++) releaseNode(level[i]);
+    }
+    free(level);
+    return root;
+}
+
+/** Copy the elements under node, in increasing order, to out[] and
+ *  return # copied.
+ */
+static int copyElements(const PNode *node, int out[]) {
+    if (node->isLeaf) {
+        memcpy(out, node->keys, node->n * sizeof(int));
+        return node->n;
+    }
+    int n = 0;
+    for (int i = 0; i < node->n; i++) n += copyElements(node->children[i], &out[n]);
+    return n;
+}
+
+/** Return a new empty version.  Returns NULL on error with errno set. */
+void *newPersistentIntSet(void) {
+    return newNode(1);
+}
+
+/** Return # of elements in version. */
+int nElementsPersistentIntSet(const void *version) {
+    return ((const PNode *)version)->nElements;
+}
+
+/** Return non-zero iff version contains element.  O(log n). */
+int isInPersistentIntSet(const void *version, int element) {
+    const PNode *node = version;
+    while (!node->isLeaf) node = node->children[childIndex(node, element)];
+    int i = lowerBound(node->keys, node->n, element);
+    return i < node->n && node->keys[i] == element;
+}
+
+/** Return a new version containing the elements of version and
+ *  element; version itself is unchanged and remains valid.  Returns
+ *  NULL on error with errno set.
+ */
+void *addPersistentIntSet(const void *version, int element) {
+    const PNode *root = version;
+    if (isInPersistentIntSet(root, element)) {
+        return retainPersistentIntSet(root);
+    }
+    PNode *out[2];
+    int nOut = insertNode(root, element, out);
+    if (nOut < 0) return NULL;
+    if (nOut == 1) return out[0];
+    //the root split, so the tree grows a level
+    PNode *newRoot[2];
+    if (makeBranches(out, 2, newRoot) < 0) {
+        releaseNode(out[0]);
+        releaseNode(out[1]);
+        return NULL;
+    }
+    return newRoot[0];
+}
+
+/** Return a new version containing the elements of version and all of
+ *  elements[nElements]; version itself is unchanged and remains valid.
+ *  Returns NULL on error with errno set.
+ */
+void *addMultiplePersistentIntSet(const void *version, const int elements[],
+                                  int nElements) {
+    const PNode *root = version;
+    //a few additions share the rest of the tree; many rebuild it packed
+    if (nElements <= root->nElements / LEAF_MAX) {
+        void *result = retainPersistentIntSet(root);
+        for (int i = 0; result && i < nElements; i++) {
+            void *next = addPersistentIntSet(result, elements[i]);
+            freePersistentIntSet(result);
+            result = next;
+        }
+        return result;
+    }
+    if ((long)root->nElements + nElements > INT_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    int nOld = root->nElements;
+    int *added = malloc(nElements * sizeof(int));
+    int *old = malloc((nOld > 0 ? nOld : 1) * sizeof(int));
+    int *merged = malloc((nOld + nElements) * sizeof(int));
+    PNode *result = NULL;
+    if (added && old && merged) {
+        memcpy(added, elements, nElements * sizeof(int));
+        int nAdded = sortUniqueInts(added, nElements);
+        if (nAdded >= 0) {
+            copyElements(root, old);
+            int n = unionSortedInts(old, nOld, added, nAdded, merged);
+            result = buildVersion(merged, n);
+        }
+    }
+    free(added);
+    free(old);
+    free(merged);
+    return result;
+}
+
+/** Take another reference to version, to be released by its own
+ *  freePersistentIntSet(), and return it.  O(1).
+ */
+void *retainPersistentIntSet(const void *version) {
+    retainNode(version);
+    return (void *)version;
+}
+
+/** Return a new int-set with the specified representation holding the
+ *  elements of version, for iteration or set algebra.  Returns NULL on
+ *  error with errno set.
+ */
+void *newIntSetFromPersistent(const void *version, IntSetBackend backend) {
+    int n = nElementsPersistentIntSet(version);
+    int *sorted = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!sorted) return NULL;
+    copyElements(version, sorted);
+    return newSortedIntSet(backend, sorted, n, n);
+}
+
+/** Release a reference to version, freeing the nodes it no longer
+ *  shares with any other version.  No-op if version is NULL.
+ */
+void freePersistentIntSet(const void *version) {
+    if (version) releaseNode((PNode *)version);
+}
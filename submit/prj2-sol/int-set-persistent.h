@@ -0,0 +1,60 @@
+#ifndef INT_SET_PERSISTENT_H_
+#define INT_SET_PERSISTENT_H_
+
+#include "int-set.h"
+
+/** Persistent int-sets: each version of a set is immutable, and adding
+ *  an element returns a new version which shares all but the changed
+ *  path of its B+-tree with the version it came from.  An addition
+ *  therefore costs O(log n) time and memory, and keeping a snapshot of
+ *  a version is O(1): take another reference with
+ *  retainPersistentIntSet().
+ *
+ *  Tree nodes are reference counted and freed once no version uses
+ *  them, so each version obtained from these routines must eventually
+ *  be released by freePersistentIntSet().  Since nodes never change
+ *  once built and counts are updated atomically, versions may be
+ *  read, added to, retained and freed from any number of threads at
+ *  once; publishing the latest version to other threads is up to the
+ *  caller.
+ */
+
+/** Return a new empty version.  Returns NULL on error with errno set. */
+void *newPersistentIntSet(void);
+
+/** Return # of elements in version. */
+int nElementsPersistentIntSet(const void *version);
+
+/** Return non-zero iff version contains element.  O(log n). */
+int isInPersistentIntSet(const void *version, int element);
+
+/** Return a new version containing the elements of version and
+ *  element; version itself is unchanged and remains valid.  Returns
+ *  NULL on error with errno set.
+ */
+void *addPersistentIntSet(const void *version, int element);
+
+/** Return a new version containing the elements of version and all of
+ *  elements[nElements]; version itself is unchanged and remains valid.
+ *  Returns NULL on error with errno set.
+ */
+void *addMultiplePersistentIntSet(const void *version, const int elements[],
+                                  int nElements);
+
+/** Take another reference to version, to be released by its own
+ *  freePersistentIntSet(), and return it.  O(1).
+ */
+void *retainPersistentIntSet(const void *version);
+
+/** Return a new int-set with the specified representation holding the
+ *  elements of version, for iteration or set algebra.  Returns NULL on
+ *  error with errno set.
+ */
+void *newIntSetFromPersistent(const void *version, IntSetBackend backend);
+
+/** Release a reference to version, freeing the nodes it no longer
+ *  shares with any other version.  No-op if version is NULL.
+ */
+void freePersistentIntSet(const void *version);
+
+#endif //ifndef INT_SET_PERSISTENT_H_
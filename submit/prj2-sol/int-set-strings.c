@@ -1,15 +1,49 @@
 #include "int-set.h"
 #include "int-set-strings.h"
 
-#include <ctype.h>
-#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+
+/** isspace() in the C locale, without the per-call locale lookup */
+static inline int
+isSpace(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline int
+isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+/** Append value to *values[*n], growing *values (of *capacity ints)
+ *  geometrically as needed.  Returns < 0 on error.
+ */
+static int
+appendValue(int **values, int *n, int *capacity, int value)
+{
+  if (*n == *capacity) {
+    int newCapacity = *capacity < 64 ? 64 : 2 * *capacity;
+    int *newValues = realloc(*values, newCapacity * sizeof(int));
+    if (!newValues) return -1;
+    *values = newValues;
+    *capacity = newCapacity;
+  }
+  (*values)[(*n)++] = value;
+  return 0;
+}
 
 /** Expects str to be of the form "{ I, I, ..., I, }", where the I's
  *  represent the integers in the IntSet. The last ',' is optional.
  *  Read intSet from char array str[] up to the terminating '}'.
  *  Permissive on whitespace.  If n is not NULL, it sets it to # of
  *  chars read from str[].  Returns scanned IntSet, NULL on error.
+ *
+ *  The values are collected in one pass over str[] and then added
+ *  together by addMultipleIntSet(), which sorts them once.
  */
 void *
 sscanIntSet(const char str[], int *n)
@@ -17,35 +51,97 @@ sscanIntSet(const char str[], int *n)
   int i = 0;
   int isErr = 0;
   void *set = NULL;
+  int *values = NULL;
+  int nValues = 0, capacity = 0;
   do {
-    while (isspace(str[i])) i++;
+    while (isSpace(str[i])) i++;
     if (str[i] != '{') { isErr = 1; break; }
     i++;
-    set = newIntSet();
     do { //look for /\s*(\-?\d+\s*,)?/
-      while (isspace(str[i])) i++;
-      if (!isdigit(str[i]) && str[i] != '-')  break;
-      char *p;
-      long val = strtol(&str[i], &p, 10);
-      i += p - &str[i];
-      addIntSet(set, val);
-      while (isspace(str[i])) i++;
+      while (isSpace(str[i])) i++;
+      int isNeg = str[i] == '-';
+      if (!isDigit(str[i + isNeg])) break;
+      i += isNeg;
+      //accumulate magnitude, saturating as strtol() does
+      unsigned long mag = 0;
+      int isOverflow = 0;
+      for (; isDigit(str[i]); i++) {
+        unsigned digit = str[i] - '0';
+        if (mag > (LONG_MAX - digit) / 10) isOverflow = 1;
+        else mag = mag * 10 + digit;
+      }
+      long val = isOverflow ? (isNeg ? LONG_MIN : LONG_MAX)
+        : isNeg ? -(long)mag : (long)mag;
+      if (appendValue(&values, &nValues, &capacity, val) < 0) {
+        isErr = 1;
+        break;
+      }
+      while (isSpace(str[i])) i++;
       if (str[i] != ',') break; //don't set isErr, making last , optional
       i++;
     } while (1);
+    if (isErr) break;
     isErr = str[i++] != '}';
   } while (0);
-  if (isErr && set) { freeIntSet(set); set = NULL; }
+  if (!isErr) {
+    set = newIntSet();
+    if (set && addMultipleIntSet(set, values, nValues) < 0) {
+      freeIntSet(set);
+      set = NULL;
+    }
+  }
+  free(values);
   if (n) *n = i;
   return set;
 }
 
-static inline char *bufNull(char *buf, int n) {
-  return buf == NULL ? NULL : buf + n;
+/** "00" "01" ... "99": two digits at a time halves the divisions */
+static const char DIGIT_PAIRS[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233"
+  "34353637383940414243444546474849505152535455565758596061626364656667"
+  "6869707172737475767778798081828384858687888990919293949596979899";
+
+/** Max # of chars formatInt() writes: "-2147483648" */
+enum { MAX_INT_CHARS = 11 };
+
+/** # of elements fetched from an iterator at a time when printing */
+enum { PRINT_BATCH = 256 };
+
+/** Write the decimal representation of value to the chars ending just
+ *  before end and return a pointer to its first char.
+ */
+static char *
+formatInt(int value, char *end)
+{
+  unsigned u = value < 0 ? -(unsigned)value : (unsigned)value;
+  while (u >= 100) {
+    const char *pair = &DIGIT_PAIRS[2 * (u % 100)];
+    u /= 100;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+  if (u >= 10) {
+    *--end = DIGIT_PAIRS[2*u + 1];
+    *--end = DIGIT_PAIRS[2*u];
+  }
+  else {
+    *--end = '0' + u;
+  }
+  if (value < 0) *--end = '-';
+  return end;
 }
 
-static inline int sizeNull(char *buf, int n) {
-  return buf == NULL ? 0 : n;
+/** Copy src[n] to buf[] at offset *len as far as it fits in size - 1
+ *  chars, and add n to *len.
+ */
+static inline void
+putChars(char *buf, size_t size, size_t *len, const char *src, size_t n)
+{
+  if (buf != NULL && *len + 1 < size) {
+    size_t room = size - 1 - *len;
+    memcpy(buf + *len, src, n < room ? n : room);
+  }
+  *len += n;
 }
 
 /** Print intSet into buf as string "{ I, I, ..., I, }" terminated by
@@ -56,18 +152,84 @@ static inline int sizeNull(char *buf, int n) {
  *  byte).  It follows that a return value of size or more means that
  *  the output was truncated and the call should be retried with a
  *  larger buf[] (at least the return value + 1 (for the terminating
- *  NUL)).
+ *  NUL)).  Returns < 0 on error with errno set.
  */
 int
 snprintIntSet(void *intSet, char *buf, size_t size)
 {
-  int n = 0;
-  n += snprintf(bufNull(buf, n), sizeNull(buf, size - n), "{ ");
-  for (const void *iter = newIntSetIterator(intSet); iter != NULL;
-       iter = stepIntSetIterator(iter)) {
-    int val = intSetIteratorElement(iter);
-    n += snprintf(bufNull(buf,  n), sizeNull(buf, size - n), "%d, ", val);
+  size_t len = 0;
+  putChars(buf, size, &len, "{ ", 2);
+  int batch[PRINT_BATCH];
+  int nPrinted = 0;
+  const void *iter = newIntSetIterator(intSet);
+  for (int n; (n = nextBatchIntSet(&iter, batch, PRINT_BATCH)) > 0; ) {
+    nPrinted += n;
+    for (int i = 0; i < n; i++) {
+      char chars[MAX_INT_CHARS + 2];
+      char *end = &chars[MAX_INT_CHARS];
+      char *start = formatInt(batch[i], end);
+      end[0] = ','; end[1] = ' ';
+      putChars(buf, size, &len, start, end + 2 - start);
+    }
+  }
+  if (nPrinted < nElementsIntSet(intSet)) {
+    errno = ENOMEM; //iterator allocation failed
+    return -1;
+  }
+  putChars(buf, size, &len, "}", 1);
+  if (buf != NULL && size > 0) buf[len < size ? len : size - 1] = '\0';
+  return len;
+}
+
+/** Return intSet printed as by snprintIntSet() in a string allocated
+ *  by malloc(), setting *n (if not NULL) to its length.  The string
+ *  is built in a single pass, in a buffer which grows as needed.
+ *  Returns NULL on error with errno set.
+ */
+char *
+stringIntSet(void *intSet, int *n)
+{
+  //typical elements need a handful of chars; grow for longer ones
+  size_t capacity = 4 * (size_t)nElementsIntSet(intSet) + 64;
+  char *str = malloc(capacity);
+  if (!str) return NULL;
+  size_t len = 0;
+  memcpy(str, "{ ", 2);
+  len += 2;
+  int batch[PRINT_BATCH];
+  int nPrinted = 0;
+  const void *iter = newIntSetIterator(intSet);
+  for (int nBatch; (nBatch = nextBatchIntSet(&iter, batch, PRINT_BATCH)) > 0; ) {
+    nPrinted += nBatch;
+    //room for the whole batch (and the closing brace) at worst case
+    size_t need = len + (size_t)nBatch * (MAX_INT_CHARS + 2) + 2;
+    if (need > capacity) {
+      while (capacity < need) capacity *= 2;
+      char *bigger = realloc(str, capacity);
+      if (!bigger) {
+        freeIntSetIterator(iter);
+        free(str);
+        return NULL;
+      }
+      str = bigger;
+    }
+    for (int i = 0; i < nBatch; i++) {
+      char chars[MAX_INT_CHARS];
+      char *end = &chars[MAX_INT_CHARS];
+      char *start = formatInt(batch[i], end);
+      memcpy(str + len, start, end - start);
+      len += end - start;
+      str[len++] = ',';
+      str[len++] = ' ';
+    }
+  }
+  if (nPrinted < nElementsIntSet(intSet)) {
+    free(str);
+    errno = ENOMEM; //iterator allocation failed
+    return NULL;
   }
-  n += snprintf(bufNull(buf, n), sizeNull(buf, size - n), "}");
-  return n;
+  str[len++] = '}';
+  str[len] = '\0';
+  if (n) *n = len;
+  return str;
 }
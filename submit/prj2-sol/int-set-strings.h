@@ -18,8 +18,14 @@ void *sscanIntSet(const char str[], int *n);
  *  which would have been written (excluding the terminating NUL
  *  byte).  It follows that a return value of size or more means that
  *  the output was truncated and the call should be retried with a
- *  larger buf[].
+ *  larger buf[].  Returns < 0 on error with errno set.
  */
 int snprintIntSet(void *intSet, char *buf, size_t size);
 
+/** Return intSet printed as by snprintIntSet() in a string allocated
+ *  by malloc(), setting *n (if not NULL) to its length.  Returns NULL
+ *  on error with errno set.
+ */
+char *stringIntSet(void *intSet, int *n);
+
 #endif //#ifndef INT_SET_STRINGS_H_
@@ -1,4 +1,14 @@
 #include "int-set.h"
+#include "int-set-array.h"
+#include "int-set-bitmap.h"
+#include "int-set-file.h"
+#include "int-set-hash.h"
+#include "int-merge.h"
+#include "int-sort.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
 
 /** Abstract data type for set of int's.  Note that sets do not allow
  *  duplicates.
@@ -7,10 +17,26 @@
 /** Return a new empty int-set.  Returns NULL on error with errno set.
  */
 void *newIntSet() {
-    //by using calloc() we set nElements to 0 and succ to NULL.
+    //by using calloc() we set backend to LIST_INT_SET, nElements to 0
+    //and succ to NULL.
     return calloc(1, sizeof(Header));
 }
 
+/** Return a new empty int-set which uses the specified representation.
+ *  newIntSet() is equivalent to newBackendIntSet(LIST_INT_SET).
+ *  Returns NULL on error with errno set.
+ */
+void *newBackendIntSet(IntSetBackend backend) {
+    if (backend < 0 || backend >= N_INT_SET_BACKENDS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    //calloc() leaves every representation empty
+    Header *header = calloc(1, sizeof(Header));
+    if (header) header->backend = backend;
+    return header;
+}
+
 /** Return # of elements in intSet */
 int nElementsIntSet(void *intSet) {
     const Header *header = (Header *)intSet;
@@ -20,6 +46,18 @@ int nElementsIntSet(void *intSet) {
 /** Return non-zero iff intSet contains element. */
 int isInIntSet(void *intSet, int element) {
     Header *header = (Header *)intSet;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        return isInArrayIntSet(header, element);
+    case BITMAP_INT_SET:
+        return isInBitmapIntSet(header, element);
+    case HASH_INT_SET:
+        return isInHashIntSet(header, element);
+    case MAPPED_INT_SET:
+        return isInMappedIntSet(header, element);
+    default:
+        break;
+    }
     for (Node *p = header->dummy.succ; p != NULL; p = p->succ) {
         if (p->value == element) {
             return 1;
@@ -28,27 +66,123 @@ int isInIntSet(void *intSet, int element) {
     return 0;
 }
 
+/** Return # of elements of intSet which are < element. */
+int rankIntSet(void *intSet, int element) {
+    Header *header = (Header *)intSet;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        return rankArrayIntSet(header, element);
+    case BITMAP_INT_SET:
+        return rankBitmapIntSet(header, element);
+    case HASH_INT_SET:
+        return rankHashIntSet(header, element);
+    case MAPPED_INT_SET:
+        return rankMappedIntSet(header, element);
+    default:
+        break;
+    }
+    int rank = 0;
+    for (Node *p = header->dummy.succ; p != NULL && p->value < element; p = p->succ) {
+        rank++;
+    }
+    return rank;
+}
+
+/** Set *element to the element of intSet with rank k; i.e. the k'th
+ *  smallest, counting from 0.  Returns 0 on success, < 0 with errno
+ *  set to EDOM if k is not in [0, nElementsIntSet(intSet)).
+ */
+int selectIntSet(void *intSet, int k, int *element) {
+    Header *header = (Header *)intSet;
+    if (k < 0 || k >= header->nElements) {
+        errno = EDOM;
+        return -1;
+    }
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        *element = header->array.elements[k];
+        break;
+    case BITMAP_INT_SET:
+        *element = selectBitmapIntSet(header, k);
+        break;
+    case HASH_INT_SET: {
+        const int *sorted = sortedHashIntSet(header);
+        if (!sorted) return -1;
+        *element = sorted[k];
+        break;
+    }
+    case MAPPED_INT_SET:
+        *element = selectMappedIntSet(header, k);
+        break;
+    default: {
+        Node *p = header->dummy.succ;
+        for (int i = 0; i < k; i++) p = p->succ;
+        *element = p->value;
+    }
+    }
+    return 0;
+}
+
+/** Return # of elements of intSet in [lo, hi]; 0 if lo > hi. */
+int rangeCountIntSet(void *intSet, int lo, int hi) {
+    if (lo > hi) return 0;
+    int nUpToHi = (hi == INT_MAX) ? nElementsIntSet(intSet)
+        : rankIntSet(intSet, hi + 1);
+    return nUpToHi - rankIntSet(intSet, lo);
+}
+
+/** Set *successor to the smallest element of intSet which is greater
+ *  than element.  Returns non-zero iff there is such an element.
+ */
+int successorIntSet(void *intSet, int element, int *successor) {
+    if (element == INT_MAX) return 0;
+    int k = rankIntSet(intSet, element + 1);
+    return k < nElementsIntSet(intSet) && selectIntSet(intSet, k, successor) == 0;
+}
+
 /** Change intSet by adding element to it.  Returns # of elements
  *  in intSet after addition.  Returns < 0 on error with errno
  *  set.
  */
 int addIntSet(void *intSet, int element) {
     Header *header = (Header *)intSet;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        return addArrayIntSet(header, element);
+    case BITMAP_INT_SET:
+        return addBitmapIntSet(header, element);
+    case HASH_INT_SET:
+        return addHashIntSet(header, element);
+    case MAPPED_INT_SET:
+        errno = EROFS;
+        return -1;
+    default:
+        break;
+    }
     Node *p0; //lagging pointer: will insert after p0.
-    for (p0 = &header->dummy; p0->succ != NULL && p0->succ->value <= element; p0 = p0->succ) {}
-    assert(p0->succ == NULL || p0->succ->value > element);
+    for (p0 = &header->dummy; p0->succ != NULL && p0->succ->value < element; p0 = p0->succ) {}
+    assert(p0->succ == NULL || p0->succ->value >= element);
+    //already in set: sets do not allow duplicates
+    if (p0->succ != NULL && p0->succ->value == element) return header->nElements;
     //create and insert new node after p0
-    if (!linkNewNodeAfter(p0, element)) return -1;
-    ++header->nElements;
-    //remove duplicates to turn list into set
-    int nRemoved = 0;
-    for (Node *p = header->dummy.succ; p != NULL; p = p->succ) {
-        while (p->succ && p->succ->value == p->value) {
-            unlinkNodeAfter(p);
-            nRemoved++;
+    if (!linkNewNodeAfter(&header->pool, p0, element)) return -1;
+    return ++header->nElements;
+}
+
+/** Merge sorted[n] (strictly increasing) into the list of header in a
+ *  single pass.  Returns # of elements after addition, < 0 on error.
+ */
+static int addSortedListIntSet(Header *header, const int sorted[], int n) {
+    Node *p0 = &header->dummy; //lagging pointer: insert after p0
+    for (int i = 0; i < n; i++) {
+        while (p0->succ != NULL && p0->succ->value < sorted[i]) p0 = p0->succ;
+        if (p0->succ != NULL && p0->succ->value == sorted[i]) {
+            p0 = p0->succ; //already in set
+            continue;
         }
+        if (!(p0 = linkNewNodeAfter(&header->pool, p0, sorted[i]))) return -1;
+        ++header->nElements;
     }
-    header->nElements -= nRemoved;
     return header->nElements;
 }
 
@@ -57,14 +191,38 @@ int addIntSet(void *intSet, int element) {
  *  < 0 on error with errno set.
  */
 int addMultipleIntSet(void *intSet, const int elements[], int nElements) {
-    int nAdd = 0;
-    for(int i=0; i < nElements; i++) {
-        nAdd = addIntSet(intSet, elements[i]);
-        if(nAdd == -1) {
-            return -1;
-        }
+    Header *header = (Header *)intSet;
+    if (header->backend == MAPPED_INT_SET) {
+        errno = EROFS;
+        return -1;
     }
-    return nAdd;
+    if (nElements <= 0) return header->nElements;
+    //hashing needs no order, so skip the sort
+    if (header->backend == HASH_INT_SET) {
+        return addManyHashIntSet(header, elements, nElements);
+    }
+    //sort and dedupe a copy so that elements can be merged in one pass
+    int *sorted = malloc(nElements * sizeof(int));
+    if (!sorted) return -1;
+    memcpy(sorted, elements, nElements * sizeof(int));
+    int n = sortUniqueInts(sorted, nElements);
+    int ret;
+    if (n < 0) {
+        ret = -1;
+    }
+    else if (header->backend == ARRAY_INT_SET) {
+        ret = addSortedArrayIntSet(header, sorted, n);
+    }
+    else if (header->backend == BITMAP_INT_SET) {
+        ret = addSortedBitmapIntSet(header, sorted, n);
+        //a bulk load is the natural point to pick run-length chunks
+        runOptimizeBitmapIntSet(header);
+    }
+    else {
+        ret = addSortedListIntSet(header, sorted, n);
+    }
+    free(sorted);
+    return ret;
 }
 
 /** Set intSetA to the union of intSetA and intSetB.  Return # of
@@ -73,36 +231,47 @@ int addMultipleIntSet(void *intSet, const int elements[], int nElements) {
 int unionIntSet(void *intSetA, void *intSetB) {
     //init stuff
     Header *headerA = (Header *)intSetA;
+    switch (headerA->backend) {
+    case ARRAY_INT_SET:
+        return unionArrayIntSet(headerA, intSetB);
+    case BITMAP_INT_SET:
+        return unionBitmapIntSet(headerA, intSetB);
+    case HASH_INT_SET:
+        return unionHashIntSet(headerA, intSetB);
+    case MAPPED_INT_SET:
+        errno = EROFS;
+        return -1;
+    default:
+        break;
+    }
     Node *pA0 = &headerA->dummy;
-    Header *headerB = (Header *)intSetB;
-    Node *pB = headerB->dummy.succ;
+    //walk B with an iterator so that B may use any representation
+    const void *pB = newIntSetIterator(intSetB);
+    //NULL for an empty B, but also if iteration could not be started
+    if (!pB && nElementsIntSet(intSetB) > 0) return -1;
+    int nAdded = 0; //# of B elements linked into A
 
-    for(;pA0->succ != NULL && pB != NULL;) {
-        if(pA0->succ->value < pB->value) {
+    for(;pB != NULL;) {
+        int valueB = intSetIteratorElement(pB);
+        if(pA0->succ != NULL && pA0->succ->value < valueB) {
             pA0 = pA0->succ;
         }
-        else if(pA0->succ->value == pB->value) {
+        else if(pA0->succ != NULL && pA0->succ->value == valueB) {
             pA0 = pA0->succ;
-            pB = pB->succ;
+            pB = stepIntSetIterator(pB);
         }
-        else if(pA0->succ->value > pB->value) {
-            pA0->succ = linkNewNodeAfter(pA0, pB->value);
-            pA0 = pA0->succ;
-            pB = pB->succ;
+        else {
+            pA0 = linkNewNodeAfter(&headerA->pool, pA0, valueB);
+            if (!pA0) {
+                freeIntSetIterator(pB);
+                headerA->nElements += nAdded;
+                return -1;
+            }
+            nAdded++;
+            pB = stepIntSetIterator(pB);
         }
     }
-    if(pA0->succ == NULL && pB != NULL) {
-        while(pB != NULL) {
-            pA0->succ = linkNewNodeAfter(pA0, pB->value);
-            pA0 = pA0->succ;
-                pB = pB->succ;
-        }
-    }
-    int count = 0;
-    for(Node *pA = headerA->dummy.succ; pA != NULL; pA = pA->succ) {
-        count++;
-    }
-    return count;
+    return headerA->nElements += nAdded;
 }
 
 /** Set intSetA to the intersection of intSetA and intSetB.  Return #
@@ -111,70 +280,539 @@ int unionIntSet(void *intSetA, void *intSetB) {
 int intersectionIntSet(void *intSetA, void *intSetB) {
     //init stuff
     Header *headerA = (Header *)intSetA;
+    switch (headerA->backend) {
+    case ARRAY_INT_SET:
+        return intersectionArrayIntSet(headerA, intSetB);
+    case BITMAP_INT_SET:
+        return intersectionBitmapIntSet(headerA, intSetB);
+    case HASH_INT_SET:
+        return intersectionHashIntSet(headerA, intSetB);
+    case MAPPED_INT_SET:
+        errno = EROFS;
+        return -1;
+    default:
+        break;
+    }
     Node *pA0 = &headerA->dummy;
-    Header *headerB = (Header *)intSetB;
-    Node *pB = headerB->dummy.succ;
+    //walk B with an iterator so that B may use any representation
+    const void *pB = newIntSetIterator(intSetB);
+    //NULL for an empty B, but also if iteration could not be started
+    if (!pB && nElementsIntSet(intSetB) > 0) return -1;
+    int nRemoved = 0; //# of A elements unlinked
 
     for(;pA0->succ != NULL && pB != NULL;) {
-        if(pA0->succ->value < pB->value) {
-            pA0->succ = unlinkNodeAfter(pA0);
+        int valueB = intSetIteratorElement(pB);
+        if(pA0->succ->value < valueB) {
+            unlinkNodeAfter(&headerA->pool, pA0);
+            nRemoved++;
         }
-        else if(pA0->succ->value == pB->value) {
+        else if(pA0->succ->value == valueB) {
             pA0 = pA0->succ;
-            pB = pB->succ;
+            pB = stepIntSetIterator(pB);
         }
-        else if(pA0->succ->value > pB->value) {
-            pB = pB->succ;
+        else {
+            pB = stepIntSetIterator(pB);
         }
     }
+    freeIntSetIterator(pB);
+    //B exhausted: remaining elements of A are not in B
     while(pA0->succ != NULL) {
-        pA0->succ = unlinkNodeAfter(pA0);
-        //if(pA0->succ) {
-        //    pA0 = pA0->succ;
-        //}
+        unlinkNodeAfter(&headerA->pool, pA0);
+        nRemoved++;
+    }
+    return headerA->nElements -= nRemoved;
+}
+
+/** Operations implemented by newSetOpIntSet() */
+typedef enum {
+    UNION_OP,
+    INTERSECTION_OP,
+    DIFFERENCE_OP,
+    SYM_DIFF_OP
+} SetOp;
+
+/** Set *elements to the elements of header in increasing order: the
+ *  array of an ARRAY_INT_SET itself, else a copy which is also
+ *  returned in *copy for the caller to free().  Returns < 0 on error.
+ */
+static int sortedElementsOf(const Header *header, const int **elements,
+                            int **copy) {
+    *copy = NULL;
+    if (header->backend == ARRAY_INT_SET) {
+        *elements = header->array.elements;
+        return 0;
+    }
+    if (header->backend == HASH_INT_SET) {
+        *elements = sortedHashIntSet((Header *)header);
+        return *elements ? 0 : -1;
+    }
+    int n = header->nElements;
+    if (!(*copy = malloc((n > 0 ? n : 1) * sizeof(int)))) return -1;
+    const void *iter = newIntSetIterator(header);
+    if (nextBatchIntSet(&iter, *copy, n) < n) {
+        free(*copy);
+        *copy = NULL;
+        errno = ENOMEM; //iterator allocation failed
+        return -1;
+    }
+    *elements = *copy;
+    return 0;
+}
+
+/** Return a new set with the specified backend containing sorted[n],
+ *  which must be strictly increasing and have been allocated by
+ *  malloc() with room for capacity ints.  sorted is taken over by the
+ *  new set (becoming the elements of an ARRAY_INT_SET) or freed.  A
+ *  MAPPED_INT_SET backend gives an ARRAY_INT_SET.
+ *  Returns NULL on error with errno set.
+ */
+void *newSortedIntSet(IntSetBackend backend, int *sorted, int n,
+                      int capacity) {
+    //a MAPPED_INT_SET only comes from a file, so yield the nearest kin
+    if (backend == MAPPED_INT_SET) backend = ARRAY_INT_SET;
+    Header *result = newBackendIntSet(backend);
+    int isOk = result != NULL;
+    if (isOk) {
+        switch (backend) {
+        case ARRAY_INT_SET:
+            result->array.elements = sorted;
+            result->array.capacity = capacity;
+            result->nElements = n;
+            sorted = NULL;
+            break;
+        case BITMAP_INT_SET:
+            isOk = addSortedBitmapIntSet(result, sorted, n) >= 0;
+            runOptimizeBitmapIntSet(result);
+            break;
+        case HASH_INT_SET:
+            //sorted becomes the ordered copy of the table
+            if ((isOk = adoptSortedHashIntSet(result, sorted, n) == 0)) sorted = NULL;
+            break;
+        default:
+            //one chunk holds every Node of the list
+            isOk = reserveNodePool(&result->pool, n) == 0;
+            Node *p0 = &result->dummy; //append after p0
+            for (int i = 0; isOk && i < n; i++) {
+                isOk = (p0 = linkNewNodeAfter(&result->pool, p0, sorted[i])) != NULL;
+            }
+            result->nElements = n;
+        }
+    }
+    free(sorted);
+    if (!isOk && result) {
+        freeIntSet(result);
+        result = NULL;
+    }
+    return result;
+}
+
+/** Return a new set, with the representation of intSetA, containing
+ *  the result of op on intSetA and intSetB.  The result is produced by
+ *  a single merge into an output allocated once for the largest
+ *  possible result.  Returns NULL on error with errno set.
+ */
+static void *newSetOpIntSet(SetOp op, void *intSetA, void *intSetB) {
+    const Header *headerA = (Header *)intSetA;
+    const Header *headerB = (Header *)intSetB;
+    int nA = headerA->nElements, nB = headerB->nElements;
+    long bound = (op == INTERSECTION_OP) ? (nA < nB ? nA : nB)
+        : (op == DIFFERENCE_OP) ? nA
+        : (long)nA + nB;
+    if (bound > INT_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    int *out = malloc((bound > 0 ? bound : 1) * sizeof(int));
+    const int *elementsA, *elementsB;
+    int *copyA = NULL, *copyB = NULL;
+    int isOk = out &&
+        sortedElementsOf(headerA, &elementsA, &copyA) == 0 &&
+        sortedElementsOf(headerB, &elementsB, &copyB) == 0;
+    void *result = NULL;
+    if (isOk) {
+        int n;
+        switch (op) {
+        case UNION_OP:
+            n = unionSortedInts(elementsA, nA, elementsB, nB, out);
+            break;
+        case INTERSECTION_OP:
+            n = intersectSortedInts(elementsA, nA, elementsB, nB, out);
+            break;
+        case DIFFERENCE_OP:
+            n = differenceSortedInts(elementsA, nA, elementsB, nB, out);
+            break;
+        default:
+            n = symDiffSortedInts(elementsA, nA, elementsB, nB, out);
+        }
+        //give back the slack of a result smaller than its bound
+        if (n < bound) {
+            int *shrunk = realloc(out, (n > 0 ? n : 1) * sizeof(int));
+            if (shrunk) {
+                out = shrunk;
+                bound = n;
+            }
+        }
+        result = newSortedIntSet(headerA->backend, out, n, bound);
+    }
+    else {
+        free(out);
+    }
+    free(copyA);
+    free(copyB);
+    return result;
+}
+
+/** Return a new int-set containing the union of intSetA and intSetB,
+ *  which are left unchanged.  The result uses the representation of
+ *  intSetA.  Returns NULL on error with errno set (EOVERFLOW if the
+ *  total size exceeds INT_MAX).
+ */
+void *newUnionIntSet(void *intSetA, void *intSetB) {
+    return newSetOpIntSet(UNION_OP, intSetA, intSetB);
+}
+
+/** Return a new int-set containing the intersection of intSetA and
+ *  intSetB, which are left unchanged.  The result uses the
+ *  representation of intSetA.  Returns NULL on error with errno set.
+ */
+void *newIntersectionIntSet(void *intSetA, void *intSetB) {
+    return newSetOpIntSet(INTERSECTION_OP, intSetA, intSetB);
+}
+
+/** Return a new int-set containing the elements of intSetA which are
+ *  not in intSetB; both are left unchanged.  The result uses the
+ *  representation of intSetA.  Returns NULL on error with errno set.
+ */
+void *newDifferenceIntSet(void *intSetA, void *intSetB) {
+    return newSetOpIntSet(DIFFERENCE_OP, intSetA, intSetB);
+}
+
+/** Return a new int-set containing the elements which are in exactly
+ *  one of intSetA and intSetB; both are left unchanged.  The result
+ *  uses the representation of intSetA.  Returns NULL on error with
+ *  errno set (EOVERFLOW if the total size exceeds INT_MAX).
+ */
+void *newSymDiffIntSet(void *intSetA, void *intSetB) {
+    return newSetOpIntSet(SYM_DIFF_OP, intSetA, intSetB);
+}
+
+/** Return a new set, with the representation of sets[0], containing
+ *  the intersection (if isIntersection) or union of sets[n].  Returns
+ *  NULL on error with errno set.
+ */
+static void *newManyIntSet(void *sets[], int n, int isIntersection) {
+    if (n < 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    long bound = isIntersection ? INT_MAX : 0;
+    for (int i = 0; i < n; i++) {
+        int nElements = ((Header *)sets[i])->nElements;
+        if (isIntersection && nElements < bound) bound = nElements;
+        if (!isIntersection) bound += nElements;
+    }
+    if (bound > INT_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    const int **arrays = calloc(n, sizeof(int *));
+    int *sizes = malloc(n * sizeof(int));
+    int **copies = calloc(n, sizeof(int *));
+    int *out = malloc((bound > 0 ? bound : 1) * sizeof(int));
+    int isOk = arrays && sizes && copies && out;
+    for (int i = 0; isOk && i < n; i++) {
+        sizes[i] = ((Header *)sets[i])->nElements;
+        isOk = sortedElementsOf(sets[i], &arrays[i], &copies[i]) == 0;
+    }
+    void *result = NULL;
+    int nOut = !isOk ? -1
+        : isIntersection ? intersectManySortedInts(arrays, sizes, n, out)
+        : unionManySortedInts(arrays, sizes, n, out);
+    if (nOut >= 0) {
+        result = newSortedIntSet(((Header *)sets[0])->backend, out, nOut, bound);
+    }
+    else {
+        free(out);
+    }
+    for (int i = 0; copies && i < n; i++) free(copies[i]);
+    free(copies);
+    free(sizes);
+    free(arrays);
+    return result;
+}
+
+/** Return a new int-set containing the intersection of sets[0], ...,
+ *  sets[n - 1], which are left unchanged.  The result uses the
+ *  representation of sets[0] and is produced in one pass over the
+ *  inputs without intermediate sets.  Returns NULL on error with errno
+ *  set (EINVAL if n < 1).
+ */
+void *intersectManyIntSet(void *sets[], int n) {
+    return newManyIntSet(sets, n, 1);
+}
+
+/** Return a new int-set containing the union of sets[0], ...,
+ *  sets[n - 1], which are left unchanged.  The result uses the
+ *  representation of sets[0] and is produced in one pass over the
+ *  inputs without intermediate sets.  Returns NULL on error with errno
+ *  set (EINVAL if n < 1, EOVERFLOW if the total size exceeds INT_MAX).
+ */
+void *unionManyIntSet(void *sets[], int n) {
+    return newManyIntSet(sets, n, 0);
+}
+
+/** Free the representation of header (but not header itself). */
+static void freeRepresentation(Header *header) {
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        freeArrayIntSet(header);
+        break;
+    case BITMAP_INT_SET:
+        freeBitmapIntSet(header);
+        break;
+    case HASH_INT_SET:
+        freeHashIntSet(header);
+        break;
+    case MAPPED_INT_SET:
+        freeMappedIntSet(header);
+        break;
+    default:
+        //all Nodes come from the pool, so no need to walk the list
+        freeNodePool(&header->pool);
     }
-    int count = 0;
-    for(Node *pA = headerA->dummy.succ; pA != NULL; pA = pA->succ) {
-        count++;
+}
+
+/** Return # of bytes of memory used by intSet: its header and all
+ *  storage allocated for its representation (or, for a MAPPED_INT_SET,
+ *  mapped), not counting allocator overhead.
+ */
+size_t memoryUsageIntSet(const void *intSet) {
+    const Header *header = (const Header *)intSet;
+    size_t size = sizeof(Header);
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        return size + header->array.capacity * sizeof(int);
+    case BITMAP_INT_SET:
+        return size + memoryUsageBitmapIntSet(header);
+    case HASH_INT_SET:
+        return size + memoryUsageHashIntSet(header);
+    case MAPPED_INT_SET:
+        return size + header->mapped.mapSize;
+    default:
+        for (const NodeChunk *p = header->pool.chunks; p != NULL; p = p->next) {
+            size += sizeof(NodeChunk) + p->nNodes * sizeof(Node);
+        }
+        return size;
     }
-    return count;
+}
+
+/** Convert intSet in place to whichever of an exactly sized
+ *  ARRAY_INT_SET or a BITMAP_INT_SET with each chunk stored as an
+ *  array, bitmap or runs (the smallest) uses less memory; meant for
+ *  sets which are no longer being changed, though they may still be.
+ *  A MAPPED_INT_SET is left as it is.  Returns 0 on success, < 0 on
+ *  error with errno set (leaving intSet unchanged).
+ */
+int compactIntSet(void *intSet) {
+    Header *header = (Header *)intSet;
+    if (header->backend == MAPPED_INT_SET) return 0; //already packed
+    int n = header->nElements;
+    const int *elements;
+    int *copy;
+    if (sortedElementsOf(header, &elements, &copy) < 0) return -1;
+    if (!copy) { //elements belong to header, which is about to be freed
+        if (!(copy = malloc((n > 0 ? n : 1) * sizeof(int)))) return -1;
+        memcpy(copy, elements, n * sizeof(int));
+        elements = copy;
+    }
+    IntSetBackend backend = (compactBitmapSize(elements, n) < n * sizeof(int))
+        ? BITMAP_INT_SET : ARRAY_INT_SET;
+    Header *compact = newSortedIntSet(backend, copy, n, n);
+    if (!compact) return -1;
+    freeRepresentation(header);
+    *header = *compact;
+    free(compact);
+    return 0;
 }
 
 /** Free all resources used by previously created intSet. */
 void freeIntSet(void *intSet) {
     Header *header = (Header *)intSet;
-    Node *p1;
-    for (Node *p = header->dummy.succ; p != NULL; p = p1) {
-        p1 = p->succ;  //must complete accesses to p before freeing p
-        free(p);
-    }
+    freeRepresentation(header);
     free(header);
 }
 
 /** Return a new iterator for intSet.  Returns NULL if intSet
- *  is empty.
+ *  is empty (or on allocation failure).  The iterator is released when
+ *  stepIntSetIterator() returns NULL; an iteration abandoned before
+ *  that must call freeIntSetIterator().
  */
 const void *newIntSetIterator(const void *intSet) {
-    Header *header = (Header *)intSet;
-    int empty = 1;
-    Node *p;
-    for (p = header->dummy.succ; p != NULL; p = p->succ) {
-        empty = 0;
+    const Header *header = (const Header *)intSet;
+    if (header->nElements == 0) return NULL;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (!iterator) return NULL;
+    iterator->header = header;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        iterator->index = 0;
+        break;
+    case HASH_INT_SET:
+        //ordered iteration sorts the table on first use
+        if (!sortedHashIntSet((Header *)header)) {
+            free(iterator);
+            return NULL;
+        }
+        iterator->index = 0;
+        break;
+    case BITMAP_INT_SET:
+        startBitmapIterator(iterator);
+        break;
+    case MAPPED_INT_SET:
+        startMappedIterator(iterator);
+        break;
+    default:
+        iterator->node = header->dummy.succ;
     }
-    p = header->dummy.succ;
-    return empty == 1 ? NULL : (const void *) p;
+    return iterator;
+}
+
+/** Return a new iterator for intSet positioned at its first element
+ *  which is >= lo, found without scanning the elements before it (see
+ *  rankIntSet()).  Returns NULL if there is no such element (or on
+ *  allocation failure).  Released as for newIntSetIterator().
+ */
+const void *newIntSetIteratorFrom(const void *intSet, int lo) {
+    const Header *header = (const Header *)intSet;
+    if (header->nElements == 0) return NULL;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (!iterator) return NULL;
+    iterator->header = header;
+    int isDone;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+        iterator->index = rankArrayIntSet(header, lo);
+        isDone = iterator->index >= header->nElements;
+        break;
+    case HASH_INT_SET:
+        if (!sortedHashIntSet((Header *)header)) {
+            free(iterator);
+            return NULL;
+        }
+        iterator->index = rankHashIntSet((Header *)header, lo);
+        isDone = iterator->index >= header->nElements;
+        break;
+    case BITMAP_INT_SET:
+        isDone = seekBitmapIterator(iterator, lo);
+        break;
+    case MAPPED_INT_SET:
+        isDone = seekMappedIterator(iterator, lo);
+        break;
+    default:
+        iterator->node = header->dummy.succ;
+        while (iterator->node != NULL && iterator->node->value < lo) {
+            iterator->node = iterator->node->succ;
+        }
+        isDone = iterator->node == NULL;
+    }
+    if (isDone) {
+        free(iterator);
+        return NULL;
+    }
+    return iterator;
 }
 
 /** Return current element for intSetIterator. */
 int intSetIteratorElement(const void *intSetIterator) {
-    Node *iterator = (Node *)intSetIterator;
-    return iterator->value;
+    const Iterator *iterator = (const Iterator *)intSetIterator;
+    switch (iterator->header->backend) {
+    case ARRAY_INT_SET:
+        return iterator->header->array.elements[iterator->index];
+    case HASH_INT_SET:
+        return iterator->header->hash.sorted[iterator->index];
+    case BITMAP_INT_SET:
+        return bitmapIteratorElement(iterator);
+    case MAPPED_INT_SET:
+        return iterator->value;
+    default:
+        return iterator->node->value;
+    }
 }
 
 /** Step intSetIterator and return stepped iterator.  Return
  *  NULL if no more iterations are possible.
  */
 const void *stepIntSetIterator(const void *intSetIterator) {
-    Node *iterator = (Node *)intSetIterator;
-    return iterator->succ ? iterator->succ : NULL;
+    Iterator *iterator = (Iterator *)intSetIterator;
+    int isDone;
+    switch (iterator->header->backend) {
+    case ARRAY_INT_SET:
+    case HASH_INT_SET:
+        isDone = ++iterator->index >= iterator->header->nElements;
+        break;
+    case BITMAP_INT_SET:
+        isDone = stepBitmapIterator(iterator);
+        break;
+    case MAPPED_INT_SET:
+        isDone = stepMappedIterator(iterator);
+        break;
+    default:
+        iterator->node = iterator->node->succ;
+        isDone = iterator->node == NULL;
+    }
+    if (isDone) {
+        free(iterator);
+        return NULL;
+    }
+    return iterator;
+}
+
+/** Copy up to max elements of an iteration to out[], starting with the
+ *  current element of *intSetIterator, and step past them.  Returns #
+ *  of elements copied.  Once the last element has been copied the
+ *  iterator is released and *intSetIterator set to NULL, after which
+ *  0 is returned.
+ */
+int nextBatchIntSet(const void **intSetIterator, int out[], int max) {
+    Iterator *iterator = (Iterator *)*intSetIterator;
+    if (!iterator || max <= 0) return 0;
+    const Header *header = iterator->header;
+    int n, isDone;
+    switch (header->backend) {
+    case ARRAY_INT_SET:
+    case HASH_INT_SET: {
+        const int *elements = header->backend == ARRAY_INT_SET
+            ? header->array.elements : header->hash.sorted;
+        n = header->nElements - iterator->index;
+        if (n > max) n = max;
+        memcpy(out, &elements[iterator->index], n * sizeof(int));
+        iterator->index += n;
+        isDone = iterator->index >= header->nElements;
+        break;
+    }
+    case BITMAP_INT_SET:
+        n = batchBitmapIterator(iterator, out, max, &isDone);
+        break;
+    case MAPPED_INT_SET:
+        n = batchMappedIterator(iterator, out, max, &isDone);
+        break;
+    default:
+        for (n = 0; n < max && iterator->node != NULL; n++) {
+            out[n] = iterator->node->value;
+            iterator->node = iterator->node->succ;
+        }
+        isDone = iterator->node == NULL;
+    }
+    if (isDone) {
+        free(iterator);
+        *intSetIterator = NULL;
+    }
+    return n;
+}
+
+/** Release an iterator before it has been stepped past the end of
+ *  its set.  No-op if intSetIterator is NULL.
+ */
+void freeIntSetIterator(const void *intSetIterator) {
+    free((void *)intSetIterator);
 }
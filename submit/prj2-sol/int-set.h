@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #ifndef INT_SET_H_
 #define INT_SET_H_
@@ -8,35 +9,221 @@ typedef struct NodeStruct { //linked-list node for int
   struct NodeStruct *succ; //point to successor node; NULL if none.
 } Node;
 
-typedef struct { //header for sorted-list
-  int nElements; //# of elements currently in list
-  Node dummy;    //dummy Node; value never used
-                 //dummy facilitates adding elements to list.
+typedef struct NodeChunkStruct { //block of Nodes carved up by a NodePool
+  struct NodeChunkStruct *next; //previously allocated chunk; NULL if none
+  int nNodes;                   //# of Nodes in nodes[]
+  Node nodes[];
+} NodeChunk;
+
+enum { //bounds on # of Nodes per chunk; chunk sizes double between them
+  MIN_NODE_CHUNK = 16,
+  MAX_NODE_CHUNK = 4096
+};
+
+typedef struct { //per-set slab allocator for list Nodes
+  NodeChunk *chunks; //chunks allocated for set, most recent first
+  int nUnused;       //# of never-used Nodes at end of chunks->nodes[]
+  Node *freeList;    //Nodes released by unlinkNodeAfter() linked by succ
+} NodePool;
+
+/** Representations available for an int-set */
+typedef enum {
+  LIST_INT_SET,  /** sorted linked-list; O(n) lookup and insert */
+  ARRAY_INT_SET, /** sorted contiguous array; O(log n) lookup */
+  BITMAP_INT_SET, /** Roaring-style compressed bitmap */
+  HASH_INT_SET,  /** open-addressing hash table; O(1) lookup and insert,
+                     sorted on first ordered use */
+  N_INT_SET_BACKENDS, /** dummy value: # of representations */
+  MAPPED_INT_SET /** read-only file mapping; from openIntSetMapped() only */
+} IntSetBackend;
+
+typedef struct { //sorted-array representation
+  int *elements; //elements[nElements] in strictly increasing order
+  int capacity;  //# of ints allocated for elements[]
+} ArrayRep;
+
+enum { //kinds of container for a chunk of a BITMAP_INT_SET
+  ARRAY_CONTAINER,  //sorted array of low 16 bits
+  BITMAP_CONTAINER, //one bit for each of the 2**16 possible low 16 bits
+  RUN_CONTAINER     //sorted runs of consecutive low 16 bits
+};
+
+enum { //sizes for BITMAP_INT_SET containers
+  MAX_ARRAY_CONTAINER = 4096,   //larger arrays become bitmaps
+  BITMAP_CONTAINER_WORDS = 1024 //# of uint64_t in a bitmap container
+};
+
+typedef struct { //run of values start, start + 1, ..., start + length
+  uint16_t start;
+  uint16_t length;  //# of values in run - 1
+} Run;
+
+typedef struct { //elements of a BITMAP_INT_SET sharing their high 16 bits
+  uint16_t key;     //high 16 bits of elements with sign bit flipped
+  uint16_t type;    //ARRAY_CONTAINER, BITMAP_CONTAINER or RUN_CONTAINER
+  int cardinality;  //# of elements in container
+  int capacity;     //# of values or runs allocated
+  int nRuns;        //RUN_CONTAINER: # of runs
+  union {
+    uint16_t *values; //ARRAY_CONTAINER: values[cardinality], increasing
+    uint64_t *words;  //BITMAP_CONTAINER: words[BITMAP_CONTAINER_WORDS]
+    Run *runs;        //RUN_CONTAINER: runs[nRuns], increasing
+  };
+} Container;
+
+typedef struct { //compressed-bitmap representation
+  Container *containers; //non-empty containers in increasing key order
+  int nContainers;       //# of containers in use
+  int capacity;          //# of Containers allocated
+  int *ranks;            //ranks[i]: # of elements before containers[i];
+                         //built on demand, NULL when out of date
+} BitmapRep;
+
+typedef struct { //open-addressing hash representation
+  int8_t *control; //control[capacity]: tag of element in slot, or empty
+  int *slots;      //slots[capacity]: elements where control is a tag
+  int capacity;    //# of slots: 0 or a power of 2, at least 16
+  int *sorted;     //sorted[nElements]: elements in increasing order;
+                   //built on demand, NULL when out of date
+} HashRep;
+
+typedef struct { //skip-table entry for a block of an int-set file
+  int32_t first;   //first element of block
+  uint32_t offset; //byte offset of block's packed gaps within data
+  uint32_t width;  //# of bits per packed gap
+} FileBlock;
+
+typedef struct { //read-only mapping of an int-set file
+  void *map;               //start of mapping
+  size_t mapSize;          //# of bytes mapped
+  const FileBlock *blocks; //blocks[nBlocks] skip table
+  int nBlocks;
+  const uint8_t *data;     //packed gaps of all blocks
+} MappedRep;
+
+typedef struct { //header for int-set
+  IntSetBackend backend; //representation used for set
+  int nElements; //# of elements currently in set
+  union {
+    struct {       //LIST_INT_SET
+      Node dummy;  //dummy Node; value never used
+                   //dummy facilitates adding elements to list.
+      NodePool pool; //allocator for all other Nodes in list
+    };
+    ArrayRep array; //ARRAY_INT_SET
+    BitmapRep bitmap; //BITMAP_INT_SET
+    HashRep hash;     //HASH_INT_SET
+    MappedRep mapped; //MAPPED_INT_SET
+  };
 } Header;
 
-static Node *
-linkNewNodeAfter(Node *p0, int value)
+typedef struct { //iterator over any representation
+  const Header *header; //set being iterated
+  union {
+    const Node *node; //LIST_INT_SET: current node
+    int index;        //ARRAY_INT_SET, HASH_INT_SET: index of current element
+    struct {          //BITMAP_INT_SET
+      int container;  //index of current container
+      int position;   //index of value, bit or run within container
+      int offset;     //RUN_CONTAINER: offset of value within run
+    };
+    struct {          //MAPPED_INT_SET
+      int block;      //index of current block
+      int inBlock;    //index of current element within block
+      int value;      //current element
+    };
+  };
+} Iterator;
+
+/** Return a Node from pool: a previously released Node if any, else
+ *  the next unused Node of the current chunk, allocating a new chunk
+ *  (twice the size of the last, up to MAX_NODE_CHUNK) when it is used
+ *  up.  Returns NULL on malloc failure.
+ */
+static inline Node *
+allocPoolNode(NodePool *pool)
+{
+    if (pool->freeList) {
+        Node *p = pool->freeList;
+        pool->freeList = p->succ;
+        return p;
+    }
+    if (pool->nUnused == 0) {
+        int nNodes = pool->chunks ? 2*pool->chunks->nNodes : MIN_NODE_CHUNK;
+        if (nNodes > MAX_NODE_CHUNK) nNodes = MAX_NODE_CHUNK;
+        NodeChunk *chunk = malloc(sizeof(NodeChunk) + nNodes*sizeof(Node));
+        if (!chunk) return NULL;
+        chunk->next = pool->chunks;
+        chunk->nNodes = nNodes;
+        pool->chunks = chunk;
+        pool->nUnused = nNodes;
+    }
+    return &pool->chunks->nodes[pool->chunks->nNodes - pool->nUnused--];
+}
+
+/** Release all Nodes of pool in O(# of chunks). */
+static inline void
+freeNodePool(NodePool *pool)
+{
+    NodeChunk *next;
+    for (NodeChunk *chunk = pool->chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+}
+
+/** Give empty pool a single chunk of n Nodes, so that a list whose
+ *  size is known in advance is built with one allocation.  Returns
+ *  < 0 on malloc failure.
+ */
+static inline int
+reserveNodePool(NodePool *pool, int n)
+{
+    assert(pool->chunks == NULL);
+    if (n <= 0) return 0;
+    NodeChunk *chunk = malloc(sizeof(NodeChunk) + n*sizeof(Node));
+    if (!chunk) return -1;
+    chunk->next = NULL;
+    chunk->nNodes = n;
+    pool->chunks = chunk;
+    pool->nUnused = n;
+    return 0;
+}
+
+static inline Node *
+linkNewNodeAfter(NodePool *pool, Node *p0, int value)
 {
     //create and insert new node after p0
-    Node *p = malloc(sizeof(Node));   //create a new Node to hold value
+    Node *p = allocPoolNode(pool);    //get a new Node to hold value
     if (!p) return NULL;              //malloc failure
     p->value = value;
     p->succ = p0->succ; p0->succ = p; //link new node into list
     return p;
 }
 
-/** Remove node after p0 from link-list freeing it up.  Link p0 to the
- *  successor of the unlinked node.  Return succ of node free'd up.
+/** Remove node after p0 from link-list returning it to pool.  Link p0
+ *  to the successor of the unlinked node.  Return succ of node free'd
+ *  up.
  */
-static Node *
-unlinkNodeAfter(Node *p0)
+static inline Node *
+unlinkNodeAfter(NodePool *pool, Node *p0)
 {
     Node *p = p0->succ;
     p0->succ = p->succ;
-    free(p);
+    p->succ = pool->freeList;
+    pool->freeList = p;
     return p0->succ;
 }
 
+/** Return a new set with the specified backend containing sorted[n],
+ *  which must be strictly increasing and have been allocated by
+ *  malloc() with room for capacity ints.  sorted is taken over by the
+ *  new set (becoming the elements of an ARRAY_INT_SET) or freed.  A
+ *  MAPPED_INT_SET backend gives an ARRAY_INT_SET.  For use by modules
+ *  which produce sorted results.  Returns NULL on error with errno set.
+ */
+void *newSortedIntSet(IntSetBackend backend, int *sorted, int n, int capacity);
+
 /** Abstract data type for set of int's.  Note that sets do not allow
  *  duplicates.
  */
@@ -45,12 +232,42 @@ unlinkNodeAfter(Node *p0)
  */
 void *newIntSet();
 
+/** Return a new empty int-set which uses the specified representation.
+ *  newIntSet() is equivalent to newBackendIntSet(LIST_INT_SET).
+ *  Returns NULL on error with errno set.
+ */
+void *newBackendIntSet(IntSetBackend backend);
+
 /** Return # of elements in intSet */
 int nElementsIntSet(void *intSet);
 
 /** Return non-zero iff intSet contains element. */
 int isInIntSet(void *intSet, int element);
 
+/** Order queries.  These take O(log n) time for ARRAY_INT_SET and
+ *  BITMAP_INT_SET (whose per-chunk counts are indexed on first use
+ *  after a change), for HASH_INT_SET once it has been sorted (on first
+ *  use after a change) and for a MAPPED_INT_SET; LIST_INT_SET walks
+ *  its list as isInIntSet() does.
+ */
+
+/** Return # of elements of intSet which are < element. */
+int rankIntSet(void *intSet, int element);
+
+/** Set *element to the element of intSet with rank k; i.e. the k'th
+ *  smallest, counting from 0.  Returns 0 on success, < 0 with errno
+ *  set to EDOM if k is not in [0, nElementsIntSet(intSet)).
+ */
+int selectIntSet(void *intSet, int k, int *element);
+
+/** Return # of elements of intSet in [lo, hi]; 0 if lo > hi. */
+int rangeCountIntSet(void *intSet, int lo, int hi);
+
+/** Set *successor to the smallest element of intSet which is greater
+ *  than element.  Returns non-zero iff there is such an element.
+ */
+int successorIntSet(void *intSet, int element, int *successor);
+
 /** Change intSet by adding element to it.  Returns # of elements
  *  in intSet after addition.  Returns < 0 on error with errno
  *  set.
@@ -73,14 +290,80 @@ int unionIntSet(void *intSetA, void *intSetB);
  */
 int intersectionIntSet(void *intSetA, void *intSetB);
 
+/** Return a new int-set containing the union of intSetA and intSetB,
+ *  which are left unchanged.  The result uses the representation of
+ *  intSetA.  Returns NULL on error with errno set (EOVERFLOW if the
+ *  total size exceeds INT_MAX).
+ */
+void *newUnionIntSet(void *intSetA, void *intSetB);
+
+/** Return a new int-set containing the intersection of intSetA and
+ *  intSetB, which are left unchanged.  The result uses the
+ *  representation of intSetA.  Returns NULL on error with errno set.
+ */
+void *newIntersectionIntSet(void *intSetA, void *intSetB);
+
+/** Return a new int-set containing the elements of intSetA which are
+ *  not in intSetB; both are left unchanged.  The result uses the
+ *  representation of intSetA.  Returns NULL on error with errno set.
+ */
+void *newDifferenceIntSet(void *intSetA, void *intSetB);
+
+/** Return a new int-set containing the elements which are in exactly
+ *  one of intSetA and intSetB; both are left unchanged.  The result
+ *  uses the representation of intSetA.  Returns NULL on error with
+ *  errno set (EOVERFLOW if the total size exceeds INT_MAX).
+ */
+void *newSymDiffIntSet(void *intSetA, void *intSetB);
+
+/** Return a new int-set containing the intersection of sets[0], ...,
+ *  sets[n - 1], which are left unchanged.  The result uses the
+ *  representation of sets[0] and is produced in one pass over the
+ *  inputs without intermediate sets.  Returns NULL on error with errno
+ *  set (EINVAL if n < 1).
+ */
+void *intersectManyIntSet(void *sets[], int n);
+
+/** Return a new int-set containing the union of sets[0], ...,
+ *  sets[n - 1], which are left unchanged.  The result uses the
+ *  representation of sets[0] and is produced in one pass over the
+ *  inputs without intermediate sets.  Returns NULL on error with errno
+ *  set (EINVAL if n < 1, EOVERFLOW if the total size exceeds INT_MAX).
+ */
+void *unionManyIntSet(void *sets[], int n);
+
+/** Return # of bytes of memory used by intSet: its header and all
+ *  storage allocated for its representation (or, for a MAPPED_INT_SET,
+ *  mapped), not counting allocator overhead.
+ */
+size_t memoryUsageIntSet(const void *intSet);
+
+/** Convert intSet in place to whichever of an exactly sized
+ *  ARRAY_INT_SET or a BITMAP_INT_SET with each chunk stored as an
+ *  array, bitmap or runs (the smallest) uses less memory; meant for
+ *  sets which are no longer being changed, though they may still be.
+ *  A MAPPED_INT_SET is left as it is.  Returns 0 on success, < 0 on
+ *  error with errno set (leaving intSet unchanged).
+ */
+int compactIntSet(void *intSet);
+
 /** Free all resources used by previously created intSet. */
 void freeIntSet(void *intSet);
 
 /** Return a new iterator for intSet.  Returns NULL if intSet
- *  is empty.
+ *  is empty (or on allocation failure).  The iterator is released when
+ *  stepIntSetIterator() returns NULL; an iteration abandoned before
+ *  that must call freeIntSetIterator().
  */
 const void *newIntSetIterator(const void *intSet);
 
+/** Return a new iterator for intSet positioned at its first element
+ *  which is >= lo, found without scanning the elements before it (see
+ *  rankIntSet()).  Returns NULL if there is no such element (or on
+ *  allocation failure).  Released as for newIntSetIterator().
+ */
+const void *newIntSetIteratorFrom(const void *intSet, int lo);
+
 /** Return current element for intSetIterator. */
 int intSetIteratorElement(const void *intSetIterator);
 
@@ -89,5 +372,21 @@ int intSetIteratorElement(const void *intSetIterator);
  */
 const void *stepIntSetIterator(const void *intSetIterator);
 
+/** Copy up to max elements of an iteration to out[], starting with the
+ *  current element of *intSetIterator, and step past them.  Returns #
+ *  of elements copied.  Once the last element has been copied the
+ *  iterator is released and *intSetIterator set to NULL, after which
+ *  0 is returned.  Typical use:
+ *
+ *    const void *iter = newIntSetIterator(intSet);
+ *    for (int n; (n = nextBatchIntSet(&iter, buf, BUF_SIZE)) > 0; ) ...
+ */
+int nextBatchIntSet(const void **intSetIterator, int out[], int max);
+
+/** Release an iterator before it has been stepped past the end of
+ *  its set.  No-op if intSetIterator is NULL.
+ */
+void freeIntSetIterator(const void *intSetIterator);
+
 
 #endif //ifndef INT_SET_H_
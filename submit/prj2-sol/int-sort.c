@@ -0,0 +1,88 @@
+#include "int-sort.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Below this size insertion sort beats the radix sort passes */
+enum { INSERTION_SORT_MAX = 32 };
+
+/** Number of radix-sort passes: one per byte of an int */
+enum { N_PASSES = sizeof(int), N_BUCKETS = 1 << CHAR_BIT };
+
+static void
+insertionSort(int elements[], int n)
+{
+  for (int i = 1; i < n; i++) {
+    int v = elements[i];
+    int j;
+    for (j = i; j > 0 && elements[j - 1] > v; j--) {
+      elements[j] = elements[j - 1];
+    }
+    elements[j] = v;
+  }
+}
+
+/** Return key for value which sorts as unsigned in the same order as
+ *  value sorts as a signed int.
+ */
+static inline unsigned
+radixKey(int value)
+{
+  return (unsigned)value ^ (1U << (sizeof(int)*CHAR_BIT - 1));
+}
+
+/** Sort elements[n] into increasing order and remove duplicates,
+ *  using an LSD radix sort on the bytes of each int.  Returns the #
+ *  of unique elements, which occupy elements[0, returned).  Returns
+ *  < 0 with errno set if scratch space cannot be allocated.
+ */
+int
+sortUniqueInts(int elements[], int n)
+{
+  if (n <= 1) return n;
+  if (n <= INSERTION_SORT_MAX) {
+    insertionSort(elements, n);
+  }
+  else {
+    int *scratch = malloc(n * sizeof(int));
+    if (!scratch) return -1;
+    //count all passes in one read of elements[]
+    int counts[N_PASSES][N_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++) {
+      unsigned key = radixKey(elements[i]);
+      for (int p = 0; p < N_PASSES; p++) {
+        counts[p][(key >> (p*CHAR_BIT)) & (N_BUCKETS - 1)]++;
+      }
+    }
+    int *src = elements, *dest = scratch;
+    for (int p = 0; p < N_PASSES; p++) {
+      //skip passes where every element falls in a single bucket
+      if (counts[p][(radixKey(src[0]) >> (p*CHAR_BIT)) & (N_BUCKETS - 1)]
+          == n) {
+        continue;
+      }
+      int offsets[N_BUCKETS];
+      int sum = 0;
+      for (int b = 0; b < N_BUCKETS; b++) {
+        offsets[b] = sum;
+        sum += counts[p][b];
+      }
+      for (int i = 0; i < n; i++) {
+        unsigned b = (radixKey(src[i]) >> (p*CHAR_BIT)) & (N_BUCKETS - 1);
+        dest[offsets[b]++] = src[i];
+      }
+      int *t = src; src = dest; dest = t;
+    }
+    if (src != elements) memcpy(elements, src, n * sizeof(int));
+    free(scratch);
+  }
+  int nUnique = 1;
+  for (int i = 1; i < n; i++) {
+    if (elements[i] != elements[nUnique - 1]) {
+      elements[nUnique++] = elements[i];
+    }
+  }
+  return nUnique;
+}
@@ -0,0 +1,11 @@
+#ifndef INT_SORT_H_
+#define INT_SORT_H_
+
+/** Sort elements[n] into increasing order and remove duplicates,
+ *  using an LSD radix sort on the bytes of each int.  Returns the #
+ *  of unique elements, which occupy elements[0, returned).  Returns
+ *  < 0 with errno set if scratch space cannot be allocated.
+ */
+int sortUniqueInts(int elements[], int n);
+
+#endif //ifndef INT_SORT_H_
@@ -0,0 +1,317 @@
+#ifndef KEY_SET_TEMPLATE_H_
+#define KEY_SET_TEMPLATE_H_
+
+/** Macro templates which define the key-set interface declared by
+ *  DECLARE_KEY_SET() in key-set.h.  Include this only from the file
+ *  which instantiates the templates; it requires <errno.h>,
+ *  <stdlib.h>, <string.h> and "int-set.h".
+ */
+
+/** Define a key-set for keys of at most 32 bits as a BITMAP_INT_SET
+ *  int-set.  toInt(key) must map keys to ints preserving order and
+ *  toKey() must invert it.
+ */
+#define DEFINE_BITMAP_KEY_SET(Name, name, Key, toInt, toKey)            \
+                                                                        \
+void *new##Name##Set(void) {                                            \
+    return newBackendIntSet(BITMAP_INT_SET);                            \
+}                                                                       \
+                                                                        \
+int nElements##Name##Set(void *set) {                                   \
+    return nElementsIntSet(set);                                        \
+}                                                                       \
+                                                                        \
+int isIn##Name##Set(void *set, Key element) {                           \
+    return isInIntSet(set, toInt(element));                             \
+}                                                                       \
+                                                                        \
+int add##Name##Set(void *set, Key element) {                            \
+    return addIntSet(set, toInt(element));                              \
+}                                                                       \
+                                                                        \
+int addMultiple##Name##Set(void *set, const Key elements[], int nElements) { \
+    if (nElements <= 0) return nElementsIntSet(set);                    \
+    int *ints = malloc(nElements * sizeof(int));                        \
+    if (!ints) return -1;                                               \
+    for (int i = 0; i < nElements; i++) ints[i] = toInt(elements[i]);   \
+    int ret = addMultipleIntSet(set, ints, nElements);                  \
+    free(ints);                                                         \
+    return ret;                                                         \
+}                                                                       \
+                                                                        \
+void free##Name##Set(void *set) {                                       \
+    freeIntSet(set);                                                    \
+}                                                                       \
+                                                                        \
+const void *new##Name##SetIterator(const void *set) {                   \
+    return newIntSetIterator(set);                                      \
+}                                                                       \
+                                                                        \
+Key name##SetIteratorElement(const void *iterator) {                    \
+    return toKey(intSetIteratorElement(iterator));                      \
+}                                                                       \
+                                                                        \
+const void *step##Name##SetIterator(const void *iterator) {             \
+    return stepIntSetIterator(iterator);                                \
+}                                                                       \
+                                                                        \
+void free##Name##SetIterator(const void *iterator) {                    \
+    freeIntSetIterator(iterator);                                       \
+}
+
+/** Max # of keys in a B+-tree node; nodes are split when they exceed
+ *  it.  64 8-byte keys span 8 cache lines, so a search touches a
+ *  handful of lines per level.
+ */
+enum { KEY_SET_BTREE_ORDER = 64 };
+
+/** Define a key-set for keys of any integer type as a B+-tree.  All
+ *  keys are in the leaves, which are linked in increasing order; each
+ *  internal node holds keys[nKeys] and children[nKeys + 1], where
+ *  keys[i] is the least key under children[i + 1].  Nodes only split
+ *  (there is no removal), so the leftmost leaf is fixed once created.
+ */
+#define DEFINE_BTREE_KEY_SET(Name, name, Key)                           \
+                                                                        \
+typedef struct Name##NodeStruct {                                       \
+    int nKeys;                                                          \
+    int isLeaf;                                                         \
+    struct Name##NodeStruct *next;   /* leaf: next leaf; NULL if last */ \
+    Key keys[KEY_SET_BTREE_ORDER + 1]; /* room for one before split */  \
+    struct Name##NodeStruct *children[]; /* internal only */            \
+} Name##Node;                                                           \
+                                                                        \
+typedef struct {                                                        \
+    Name##Node *root;  /* NULL if set is empty */                       \
+    Name##Node *first; /* leftmost leaf */                              \
+    int nElements;                                                      \
+} Name##Set;                                                            \
+                                                                        \
+typedef struct {                                                        \
+    const Name##Node *leaf; /* leaf of current element */               \
+    int index;              /* index of current element in leaf */      \
+} Name##Iterator;                                                       \
+                                                                        \
+/** Return a new empty node.  Returns NULL on error. */                 \
+static Name##Node *new##Name##Node(int isLeaf) {                        \
+    size_t size = sizeof(Name##Node) +                                  \
+        (isLeaf ? 0 : (KEY_SET_BTREE_ORDER + 2) * sizeof(Name##Node *)); \
+    Name##Node *node = malloc(size);                                    \
+    if (node) {                                                         \
+        node->nKeys = 0;                                                \
+        node->isLeaf = isLeaf;                                          \
+        node->next = NULL;                                              \
+    }                                                                   \
+    return node;                                                        \
+}                                                                       \
+                                                                        \
+/** Return index of first of keys[n] which is >= key; n if none */      \
+static int name##LowerBound(const Key keys[], int n, Key key) {         \
+    int lo = 0, hi = n;                                                 \
+    while (lo < hi) {                                                   \
+        int mid = lo + (hi - lo)/2;                                     \
+        if (keys[mid] < key) lo = mid + 1; else hi = mid;               \
+    }                                                                   \
+    return lo;                                                          \
+}                                                                       \
+                                                                        \
+/** Return index of first of keys[n] which is > key; n if none */       \
+static int name##UpperBound(const Key keys[], int n, Key key) {         \
+    int lo = 0, hi = n;                                                 \
+    while (lo < hi) {                                                   \
+        int mid = lo + (hi - lo)/2;                                     \
+        if (keys[mid] <= key) lo = mid + 1; else hi = mid;              \
+    }                                                                   \
+    return lo;                                                          \
+}                                                                       \
+                                                                        \
+/** Split node, which has one key too many, moving its upper half to    \
+ *  the empty node right.  Sets *separator to the least key under      \
+ *  right.                                                              \
+ */                                                                     \
+static void split##Name##Node(Name##Node *node, Name##Node *right,      \
+                              Key *separator) {                         \
+    if (node->isLeaf) {                                                 \
+        int nLeft = node->nKeys / 2;                                    \
+        right->nKeys = node->nKeys - nLeft;                             \
+        memcpy(right->keys, &node->keys[nLeft], right->nKeys * sizeof(Key)); \
+        node->nKeys = nLeft;                                            \
+        right->next = node->next;                                       \
+        node->next = right;                                             \
+        *separator = right->keys[0];                                    \
+    }                                                                   \
+    else { /* middle key moves up to the parent */                      \
+        int mid = node->nKeys / 2;                                      \
+        *separator = node->keys[mid];                                   \
+        right->nKeys = node->nKeys - mid - 1;                           \
+        memcpy(right->keys, &node->keys[mid + 1], right->nKeys * sizeof(Key)); \
+        memcpy(right->children, &node->children[mid + 1],               \
+               (right->nKeys + 1) * sizeof(Name##Node *));              \
+        node->nKeys = mid;                                              \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+/** Insert key into the subtree rooted at node.  Returns 1 if added, 0  \
+ *  if already present, < 0 on error (subtree unchanged).  If node      \
+ *  had to be split, sets *sibling to its new right sibling and         \
+ *  *separator to the least key under it; else sets *sibling to NULL.   \
+ */                                                                     \
+static int insert##Name##Node(Name##Node *node, Key key,                \
+                              Name##Node **sibling, Key *separator) {   \
+    *sibling = NULL;                                                    \
+    /* allocate before changing anything so that failure is clean */    \
+    Name##Node *right = NULL;                                           \
+    if (node->nKeys == KEY_SET_BTREE_ORDER &&                           \
+        !(right = new##Name##Node(node->isLeaf))) {                     \
+        return -1;                                                      \
+    }                                                                   \
+    int ret = 1;                                                        \
+    if (node->isLeaf) {                                                 \
+        int i = name##LowerBound(node->keys, node->nKeys, key);         \
+        if (i < node->nKeys && node->keys[i] == key) {                  \
+            ret = 0;                                                    \
+        }                                                               \
+        else {                                                          \
+            memmove(&node->keys[i + 1], &node->keys[i],                 \
+                    (node->nKeys - i) * sizeof(Key));                   \
+            node->keys[i] = key;                                        \
+            node->nKeys++;                                              \
+        }                                                               \
+    }                                                                   \
+    else {                                                              \
+        int i = name##UpperBound(node->keys, node->nKeys, key);         \
+        Name##Node *childSibling;                                       \
+        Key childSeparator;                                             \
+        ret = insert##Name##Node(node->children[i], key, &childSibling, \
+                                 &childSeparator);                      \
+        if (childSibling) {                                             \
+            memmove(&node->keys[i + 1], &node->keys[i],                 \
+                    (node->nKeys - i) * sizeof(Key));                   \
+            memmove(&node->children[i + 2], &node->children[i + 1],     \
+                    (node->nKeys - i) * sizeof(Name##Node *));          \
+            node->keys[i] = childSeparator;                             \
+            node->children[i + 1] = childSibling;                       \
+            node->nKeys++;                                              \
+        }                                                               \
+    }                                                                   \
+    if (node->nKeys > KEY_SET_BTREE_ORDER) {                            \
+        split##Name##Node(node, right, separator);                      \
+        *sibling = right;                                               \
+    }                                                                   \
+    else {                                                              \
+        free(right);                                                    \
+    }                                                                   \
+    return ret;                                                         \
+}                                                                       \
+                                                                        \
+static void free##Name##Node(Name##Node *node) {                        \
+    if (!node->isLeaf) {                                                \
+        for (int i = 0; i <= node->nKeys; i++) {                        \
+            free##Name##Node(node->children[i]);                        \
+        }                                                               \
+    }                                                                   \
+    free(node);                                                         \
+}                                                                       \
+                                                                        \
+static int compare##Name(const void *p1, const void *p2) {              \
+    Key k1 = *(const Key *)p1, k2 = *(const Key *)p2;                   \
+    return (k1 > k2) - (k1 < k2);                                       \
+}                                                                       \
+                                                                        \
+void *new##Name##Set(void) {                                            \
+    return calloc(1, sizeof(Name##Set));                                \
+}                                                                       \
+                                                                        \
+int nElements##Name##Set(void *set) {                                   \
+    return ((Name##Set *)set)->nElements;                               \
+}                                                                       \
+                                                                        \
+int isIn##Name##Set(void *set, Key element) {                           \
+    const Name##Node *node = ((Name##Set *)set)->root;                  \
+    if (!node) return 0;                                                \
+    while (!node->isLeaf) {                                             \
+        node = node->children[name##UpperBound(node->keys, node->nKeys, \
+                                               element)];               \
+    }                                                                   \
+    int i = name##LowerBound(node->keys, node->nKeys, element);         \
+    return i < node->nKeys && node->keys[i] == element;                 \
+}                                                                       \
+                                                                        \
+int add##Name##Set(void *set, Key element) {                            \
+    Name##Set *s = (Name##Set *)set;                                    \
+    if (!s->root && !(s->root = s->first = new##Name##Node(1))) {       \
+        return -1;                                                      \
+    }                                                                   \
+    /* a full root may split, needing a new root above it */            \
+    Name##Node *root = NULL;                                            \
+    if (s->root->nKeys == KEY_SET_BTREE_ORDER &&                        \
+        !(root = new##Name##Node(0))) {                                 \
+        return -1;                                                      \
+    }                                                                   \
+    Name##Node *sibling;                                                \
+    Key separator;                                                      \
+    int ret = insert##Name##Node(s->root, element, &sibling, &separator); \
+    if (sibling) {                                                      \
+        root->nKeys = 1;                                                \
+        root->keys[0] = separator;                                      \
+        root->children[0] = s->root;                                    \
+        root->children[1] = sibling;                                    \
+        s->root = root;                                                 \
+    }                                                                   \
+    else {                                                              \
+        free(root);                                                     \
+    }                                                                   \
+    return ret < 0 ? -1 : (s->nElements += ret);                        \
+}                                                                       \
+                                                                        \
+int addMultiple##Name##Set(void *set, const Key elements[], int nElements) { \
+    Name##Set *s = (Name##Set *)set;                                    \
+    if (nElements <= 0) return s->nElements;                            \
+    /* sorted order keeps successive inserts on the same path */        \
+    Key *sorted = malloc(nElements * sizeof(Key));                      \
+    if (!sorted) return -1;                                             \
+    memcpy(sorted, elements, nElements * sizeof(Key));                  \
+    qsort(sorted, nElements, sizeof(Key), compare##Name);               \
+    int ret = s->nElements;                                             \
+    for (int i = 0; i < nElements && ret >= 0; i++) {                   \
+        ret = add##Name##Set(set, sorted[i]);                           \
+    }                                                                   \
+    free(sorted);                                                       \
+    return ret;                                                         \
+}                                                                       \
+                                                                        \
+void free##Name##Set(void *set) {                                       \
+    Name##Set *s = (Name##Set *)set;                                    \
+    if (s->root) free##Name##Node(s->root);                             \
+    free(s);                                                            \
+}                                                                       \
+                                                                        \
+const void *new##Name##SetIterator(const void *set) {                   \
+    const Name##Set *s = (const Name##Set *)set;                        \
+    if (s->nElements == 0) return NULL;                                 \
+    Name##Iterator *iterator = malloc(sizeof(Name##Iterator));          \
+    if (!iterator) return NULL;                                         \
+    iterator->leaf = s->first;                                          \
+    iterator->index = 0;                                                \
+    return iterator;                                                    \
+}                                                                       \
+                                                                        \
+Key name##SetIteratorElement(const void *iterator) {                    \
+    const Name##Iterator *it = (const Name##Iterator *)iterator;        \
+    return it->leaf->keys[it->index];                                   \
+}                                                                       \
+                                                                        \
+const void *step##Name##SetIterator(const void *iterator) {             \
+    Name##Iterator *it = (Name##Iterator *)iterator;                    \
+    if (++it->index < it->leaf->nKeys) return it;                       \
+    it->index = 0;                                                      \
+    if ((it->leaf = it->leaf->next)) return it;                         \
+    free(it);                                                           \
+    return NULL;                                                        \
+}                                                                       \
+                                                                        \
+void free##Name##SetIterator(const void *iterator) {                    \
+    free((void *)iterator);                                             \
+}
+
+#endif //ifndef KEY_SET_TEMPLATE_H_
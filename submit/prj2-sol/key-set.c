@@ -0,0 +1,22 @@
+#include "key-set.h"
+#include "int-set.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "key-set-template.h"
+
+/** Order-preserving maps between 32-bit keys and ints: int32_t keys
+ *  are ints already; uint32_t keys have their top bit flipped so that
+ *  0 maps to INT_MIN.
+ */
+static inline int int32ToInt(int32_t key) { return key; }
+static inline int32_t intToInt32(int value) { return value; }
+static inline int uInt32ToInt(uint32_t key) { return (int)(key ^ 0x80000000u); }
+static inline uint32_t intToUInt32(int value) { return (uint32_t)value ^ 0x80000000u; }
+
+DEFINE_BITMAP_KEY_SET(Int32, int32, int32_t, int32ToInt, intToInt32)
+DEFINE_BITMAP_KEY_SET(UInt32, uInt32, uint32_t, uInt32ToInt, intToUInt32)
+DEFINE_BTREE_KEY_SET(Int64, int64, int64_t)
+DEFINE_BTREE_KEY_SET(UInt64, uInt64, uint64_t)
@@ -0,0 +1,74 @@
+#ifndef KEY_SET_H_
+#define KEY_SET_H_
+
+#include <stdint.h>
+
+/** Sets of fixed-width integer keys, generated from one macro template
+ *  for each key type.  Every variant has the interface of int-set.h
+ *  with Name in place of Int and the key type in place of int:
+ *
+ *    void *newInt64Set(void);
+ *    int addInt64Set(void *set, int64_t element);
+ *    int64_t int64SetIteratorElement(const void *iterator);
+ *    ...
+ *
+ *  Keys of up to 32 bits are stored in a BITMAP_INT_SET int-set
+ *  (see int-set-bitmap.h), mapping each key to an int so that int
+ *  order matches key order.  Wider keys are stored in a B+-tree whose
+ *  leaves are linked for iteration (see key-set-template.h).  Either
+ *  way, lookup and insertion are O(log n) and iteration is in
+ *  increasing key order.  A set holds at most INT_MAX elements.
+ */
+
+/** Declare the interface of a key-set named Name (name in lower camel
+ *  case for the iterator element function) with keys of type Key.
+ */
+#define DECLARE_KEY_SET(Name, name, Key)                                \
+                                                                        \
+/** Return a new empty set.  Returns NULL on error with errno set. */   \
+void *new##Name##Set(void);                                             \
+                                                                        \
+/** Return # of elements in set */                                      \
+int nElements##Name##Set(void *set);                                    \
+                                                                        \
+/** Return non-zero iff set contains element. */                        \
+int isIn##Name##Set(void *set, Key element);                            \
+                                                                        \
+/** Add element to set.  Returns # of elements in set after addition,   \
+ *  < 0 on error with errno set.                                        \
+ */                                                                     \
+int add##Name##Set(void *set, Key element);                             \
+                                                                        \
+/** Add all of elements[nElements] to set.  Returns # of elements in    \
+ *  set after addition, < 0 on error with errno set.                    \
+ */                                                                     \
+int addMultiple##Name##Set(void *set, const Key elements[], int nElements); \
+                                                                        \
+/** Free all resources used by set. */                                  \
+void free##Name##Set(void *set);                                        \
+                                                                        \
+/** Return a new iterator over set in increasing order; NULL if set is  \
+ *  empty (or on allocation failure).  Released as for                  \
+ *  newIntSetIterator().                                                \
+ */                                                                     \
+const void *new##Name##SetIterator(const void *set);                    \
+                                                                        \
+/** Return current element of iterator. */                              \
+Key name##SetIteratorElement(const void *iterator);                     \
+                                                                        \
+/** Step iterator and return it; NULL (having released it) if there     \
+ *  are no more elements.                                               \
+ */                                                                     \
+const void *step##Name##SetIterator(const void *iterator);              \
+                                                                        \
+/** Release an iterator before it has been stepped past the end of its  \
+ *  set.  No-op if iterator is NULL.                                    \
+ */                                                                     \
+void free##Name##SetIterator(const void *iterator);
+
+DECLARE_KEY_SET(Int32, int32, int32_t)
+DECLARE_KEY_SET(UInt32, uInt32, uint32_t)
+DECLARE_KEY_SET(Int64, int64, int64_t)
+DECLARE_KEY_SET(UInt64, uInt64, uint64_t)
+
+#endif //ifndef KEY_SET_H_
@@ -29,15 +29,27 @@ getIntSet(const char *arg)
   return set;
 }
 
+/** Print set followed by a newline on out */
+static void
+printIntSet(void *set, FILE *out)
+{
+  int n;
+  char *str = stringIntSet(set, &n);
+  if (str == NULL) {
+    fprintf(stderr, "cannot print set: %s\n", strerror(errno));
+    exit(1);
+  }
+  fwrite(str, 1, n, out);
+  fputc('\n', out);
+  free(str);
+}
+
 static void
 doSet(const char *arg, FILE *out)
 {
   void *set = getIntSet(arg);
-  int n = snprintIntSet(set, NULL, 0);
-  char buf[n + 1];
-  snprintIntSet(set, buf, n + 1);
+  printIntSet(set, out);
   freeIntSet(set);
-  fprintf(out, "%s\n", buf);
 }
 
 static void
@@ -51,12 +63,9 @@ doBinary(int isUnion, const char *arg1, const char *arg2, FILE *out)
             strerror(errno));
     exit(1);
   }
-  int n = snprintIntSet(set1, NULL, 0);
-  char buf[n + 1];
-  snprintIntSet(set1, buf, n + 1);
+  printIntSet(set1, out);
   freeIntSet(set1);
   freeIntSet(set2);
-  fprintf(out, "%s\n", buf);
 }
 
 int
@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L  //for clock_gettime() under -std=c18
+
+#include "int-merge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Benchmark for the sorted-array kernels in int-merge.h.  Times each
+ *  intersection and union kernel on pairs of sorted sets whose sizes
+ *  differ by increasing ratios, so that the plain merge can be compared
+ *  against the SIMD and galloping kernels.
+ */
+
+static void
+usage(const char *program, const char *msg)
+{
+  fprintf(stderr, "%susage: %s [-n N_LARGE] [-r N_REPS] [-s seed] "
+          "[-o CSV_FILE] [RATIO...]\n"
+          "  -n: # of elements in the larger set (default %d)\n"
+          "  -r: # of timed repetitions per kernel (default %d)\n"
+          "  -s: seed for set generation (default 0)\n"
+          "  -o: write machine-readable CSV results to CSV_FILE\n"
+          "  RATIO: size ratios of larger to smaller set "
+          "(default: 1 4 16 64 256 1024 4096)\n",
+          msg, program, 1000000, 5);
+  exit(1);
+}
+
+static const int RATIOS[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+
+typedef int SortedKernel(const int a[], int nA, const int b[], int nB,
+                         int out[]);
+
+typedef struct {
+  const char *op;
+  const char *name;
+  SortedKernel *kernel;
+} KernelName;
+
+static const KernelName KERNELS[] = {
+  { "intersect", "merge", mergeIntersectSortedInts },
+  { "intersect", "simd", simdIntersectSortedInts },
+  { "intersect", "gallop", gallopIntersectSortedInts },
+  { "intersect", "auto", intersectSortedInts },
+  { "union", "merge", mergeUnionSortedInts },
+  { "union", "gallop", gallopUnionSortedInts },
+  { "union", "auto", unionSortedInts },
+};
+
+/** Simple xorshift64* generator so that sets do not depend on rand() */
+static unsigned long
+next_random(unsigned long *state)
+{
+  unsigned long x = *state;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DUL;
+}
+
+/** Fill v[n] with strictly increasing values spread over [0, span),
+ *  with random gaps averaging span/n.
+ */
+static void
+make_sorted(int v[], int n, long span, unsigned long *state)
+{
+  long maxGap = 2 * span / n;
+  if (maxGap < 1) maxGap = 1;
+  long x = 0;
+  for (int i = 0; i < n; i++) {
+    x += 1 + next_random(state) % maxGap;
+    v[i] = x;
+  }
+}
+
+static double
+elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+static int
+double_compare(const void *p1, const void *p2)
+{
+  double d1 = *(const double *)p1;
+  double d2 = *(const double *)p2;
+  return (d1 > d2) - (d1 < d2);
+}
+
+/** Time nReps runs of kernel on large[nLarge] and small[nSmall],
+ *  storing ns for each run in ns[] in sorted order.  Returns the size
+ *  of the result.
+ */
+static int
+time_kernel(SortedKernel *kernel, const int large[], int nLarge,
+            const int small[], int nSmall, int out[], int nReps, double ns[])
+{
+  int n = 0;
+  for (int r = 0; r < nReps; r++) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    n = kernel(large, nLarge, small, nSmall, out);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns[r] = elapsed_ns(&t0, &t1);
+  }
+  qsort(ns, nReps, sizeof(double), double_compare);
+  return n;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  const char *program = argv[0];
+  int nLarge = 1000000;
+  int nReps = 5;
+  unsigned long seed = 0;
+  const char *csvPath = NULL;
+  int i;
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    const char *opt = argv[i];
+    if (strlen(opt) != 2 || strchr("nrso", opt[1]) == NULL) {
+      usage(program, "invalid option\n");
+    }
+    if (i >= argc - 1) usage(program, "option requires additional argument\n");
+    const char *arg = argv[++i];
+    if (opt[1] == 'o') {
+      csvPath = arg;
+      continue;
+    }
+    char *p;
+    long v = strtol(arg, &p, 10);
+    if (*p != '\0' || v < 0 || (v == 0 && opt[1] != 's')) {
+      usage(program, "option value must be a positive integer\n");
+    }
+    switch (opt[1]) {
+    case 'n': nLarge = v; break;
+    case 'r': nReps = v; break;
+    case 's': seed = v; break;
+    }
+  }
+  int nRatios = (i < argc) ? argc - i : sizeof(RATIOS)/sizeof(RATIOS[0]);
+  int *ratios = malloc(nRatios * sizeof(int));
+  if (!ratios) { perror("malloc"); exit(1); }
+  for (int r = 0; r < nRatios; r++) {
+    if (i < argc) {
+      char *p;
+      ratios[r] = strtol(argv[i + r], &p, 10);
+      if (*p != '\0' || ratios[r] <= 0) usage(program, "invalid ratio\n");
+    }
+    else {
+      ratios[r] = RATIOS[r];
+    }
+  }
+
+  FILE *csv = NULL;
+  if (csvPath) {
+    if (!(csv = fopen(csvPath, "w"))) { perror(csvPath); exit(1); }
+    fprintf(csv, "op,kernel,n_large,n_small,ratio,result,reps,"
+            "ns_min,ns_p50,ns_max,elements_per_sec\n");
+  }
+  printf("%-9s %-6s %9s %9s %6s %9s %12s %12s %14s\n",
+         "op", "kernel", "n-large", "n-small", "ratio", "result",
+         "us-min", "us-p50", "elements/sec");
+
+  //both sets span the same range of values so that they overlap
+  long span = 2L * nLarge;
+  int *large = malloc(nLarge * sizeof(int));
+  int *small = malloc(nLarge * sizeof(int));
+  int *out = malloc(2 * nLarge * sizeof(int));
+  double *ns = malloc(nReps * sizeof(double));
+  if (!large || !small || !out || !ns) { perror("malloc"); exit(1); }
+  unsigned long state = seed | 1;
+  make_sorted(large, nLarge, span, &state);
+  for (int r = 0; r < nRatios; r++) {
+    int nSmall = nLarge / ratios[r];
+    if (nSmall < 1) nSmall = 1;
+    make_sorted(small, nSmall, span, &state);
+    for (int k = 0; k < sizeof(KERNELS)/sizeof(KERNELS[0]); k++) {
+      int n = time_kernel(KERNELS[k].kernel, large, nLarge, small, nSmall,
+                          out, nReps, ns);
+      double p50 = ns[(nReps - 1)/2];
+      double rate = (nLarge + nSmall) * 1e9 / p50;
+      printf("%-9s %-6s %9d %9d %6d %9d %12.1f %12.1f %14.0f\n",
+             KERNELS[k].op, KERNELS[k].name, nLarge, nSmall, ratios[r], n,
+             ns[0]/1e3, p50/1e3, rate);
+      if (csv) {
+        fprintf(csv, "%s,%s,%d,%d,%d,%d,%d,%.0f,%.0f,%.0f,%.0f\n",
+                KERNELS[k].op, KERNELS[k].name, nLarge, nSmall, ratios[r], n,
+                nReps, ns[0], p50, ns[nReps - 1], rate);
+      }
+    }
+  }
+  free(large);
+  free(small);
+  free(out);
+  free(ns);
+  free(ratios);
+  if (csv) fclose(csv);
+  return 0;
+}
@@ -1,10 +1,25 @@
+#define _POSIX_C_SOURCE 200809L  //for getpid(), truncate() under -std=c18
+
 #include "int-set.h"
 #include "int-set-strings.h"
+#include "int-merge.h"
+#include "int-set-concurrent.h"
+#include "int-set-parallel.h"
+#include "int-set-persistent.h"
+#include "int-set-file.h"
+#include "key-set.h"
 
 #include <check.h>
 
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 /*************************** newIntSet() Tests *************************/
 
@@ -98,12 +113,59 @@ START_TEST(multiAdd)
 END_TEST
 
 
+/** Add elements in 3 batches of pseudo-random values (with duplicates
+ *  and extreme values) to a set with backend and check that the set
+ *  contains exactly the distinct values in increasing order.
+ */
+static void
+multiAddBatchesTest(IntSetBackend backend)
+{
+  enum { N = 3000, RANGE = 2000 };
+  static char isIn[RANGE];
+  memset(isIn, 0, sizeof(isIn));
+  void *set = newBackendIntSet(backend);
+  int elements[N];
+  unsigned seed = 1;
+  for (int batch = 0; batch < 3; batch++) {
+    int nDistinct = 0;
+    for (int i = 0; i < N; i++) {
+      seed = seed * 1103515245 + 12345;
+      elements[i] = (int)((seed >> 8) % RANGE) - RANGE/2;
+      isIn[elements[i] + RANGE/2] = 1;
+    }
+    for (int i = 0; i < RANGE; i++) nDistinct += isIn[i];
+    ck_assert_int_eq(addMultipleIntSet(set, elements, N), nDistinct);
+  }
+  int extremes[] = { INT_MAX, INT_MIN, 0, INT_MIN };
+  int n = addMultipleIntSet(set, extremes, 4);
+  ck_assert_int_eq(n, nElementsIntSet(set));
+  isIn[RANGE/2] = 1; //0 added by extremes[]
+  const void *iter = newIntSetIterator(set);
+  ck_assert_int_eq(intSetIteratorElement(iter), INT_MIN);
+  iter = stepIntSetIterator(iter);
+  for (int i = 0; i < RANGE; i++) {
+    if (!isIn[i]) continue;
+    ck_assert_int_eq(intSetIteratorElement(iter), i - RANGE/2);
+    iter = stepIntSetIterator(iter);
+  }
+  ck_assert_int_eq(intSetIteratorElement(iter), INT_MAX);
+  ck_assert_ptr_eq(stepIntSetIterator(iter), NULL);
+  freeIntSet(set);
+}
+
+START_TEST(multiAddBatches)
+{
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) multiAddBatchesTest(b);
+}
+END_TEST
+
 static Suite *
 addMultipleIntSetSuite(void)
 {
   Suite *suite = suite_create("addMultipleIntSet");
   TCase *tests = tcase_create("addMultiple");
   tcase_add_test(tests, multiAdd);
+  tcase_add_test(tests, multiAddBatches);
   suite_add_tcase(suite, tests);
   return suite;
 }
@@ -327,6 +389,35 @@ sscanIntSetSuite(void)
   return suite;
 }
 
+/** Check that set1 and set2 have identical elements in identical order */
+static void
+checkSameElements(void *set1, void *set2)
+{
+  ck_assert_int_eq(nElementsIntSet(set1), nElementsIntSet(set2));
+  const void *iter2 = newIntSetIterator(set2);
+  for (const void *iter1 = newIntSetIterator(set1); iter1 != NULL;
+       iter1 = stepIntSetIterator(iter1)) {
+    ck_assert_ptr_ne(iter2, NULL);
+    ck_assert_int_eq(intSetIteratorElement(iter1), intSetIteratorElement(iter2));
+    iter2 = stepIntSetIterator(iter2);
+  }
+  ck_assert_ptr_eq(iter2, NULL);
+}
+
+/** Check that set has exactly the elements expected[nExpected] */
+static void
+checkElements(void *set, const int expected[], int nExpected)
+{
+  ck_assert_int_eq(nElementsIntSet(set), nExpected);
+  int i = 0;
+  for (const void *iter = newIntSetIterator(set); iter != NULL;
+       iter = stepIntSetIterator(iter)) {
+    ck_assert_int_lt(i, nExpected);
+    ck_assert_int_eq(intSetIteratorElement(iter), expected[i++]);
+  }
+  ck_assert_int_eq(i, nExpected);
+}
+
 /**************************** snprint Tests ****************************/
 
 static void
@@ -367,6 +458,63 @@ START_TEST(snprintMulti)
 }
 END_TEST
 
+START_TEST(snprintExtremes)
+{
+  snprintTest((int[]){ INT_MIN, -100, -99, -10, -9, -1, 0, 9, 10, 99, 100,
+                       1234567, INT_MAX }, 13,
+              "{ -2147483648, -100, -99, -10, -9, -1, 0, 9, 10, 99, 100, "
+              "1234567, 2147483647, }");
+}
+END_TEST
+
+START_TEST(snprintTruncated)
+{
+  void *set = newIntSet();
+  addMultipleIntSet(set, (int[]){ 123, -45 }, 2);
+  const char *full = "{ -45, 123, }";
+  for (int size = 0; size <= strlen(full) + 1; size++) {
+    char buf[32];
+    memset(buf, 'x', sizeof(buf));
+    ck_assert_int_eq(snprintIntSet(set, buf, size), strlen(full));
+    if (size > 0) {
+      ck_assert_int_eq(strlen(buf), size - 1);
+      ck_assert_int_eq(strncmp(buf, full, size - 1), 0);
+    }
+    ck_assert_int_eq(buf[size], 'x');
+  }
+  freeIntSet(set);
+}
+END_TEST
+
+START_TEST(stringLargeRoundTrip)
+{
+  enum { N = 100000 };
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  unsigned seed = 7;
+  for (int i = 0; i < N; i++) {
+    seed = seed * 1103515245 + 12345;
+    addIntSet(set, (int)seed);
+  }
+  int n;
+  char *str = stringIntSet(set, &n);
+  ck_assert_ptr_ne(str, NULL);
+  ck_assert_int_eq(n, strlen(str));
+  ck_assert_int_eq(snprintIntSet(set, NULL, 0), n);
+  char *buf = malloc(n + 1);
+  snprintIntSet(set, buf, n + 1);
+  ck_assert_str_eq(buf, str);
+  int nScanned;
+  void *scanned = sscanIntSet(str, &nScanned);
+  ck_assert_ptr_ne(scanned, NULL);
+  ck_assert_int_eq(nScanned, n);
+  checkSameElements(scanned, set);
+  free(buf);
+  free(str);
+  freeIntSet(scanned);
+  freeIntSet(set);
+}
+END_TEST
+
 static Suite *
 snprintIntSetSuite(void)
 {
@@ -376,6 +524,9 @@ snprintIntSetSuite(void)
   tcase_add_test(snprintTests, snprint1);
   tcase_add_test(snprintTests, snprint1Negative);
   tcase_add_test(snprintTests, snprintMulti);
+  tcase_add_test(snprintTests, snprintExtremes);
+  tcase_add_test(snprintTests, snprintTruncated);
+  tcase_add_test(snprintTests, stringLargeRoundTrip);
   suite_add_tcase(suite, snprintTests);
   return suite;
 }
@@ -589,6 +740,62 @@ END_TEST
 
 
 
+START_TEST(intersectionThenUnionReusesNodes)
+{
+  enum { N = 10000 };
+  void *set = newIntSet();
+  void *evens = newIntSet();
+  void *all = newIntSet();
+  for (int i = 0; i < N; i++) {
+    addIntSet(all, i);
+    if (i % 2 == 0) addIntSet(evens, i);
+  }
+  for (int k = 0; k < 3; k++) {
+    ck_assert_int_eq(unionIntSet(set, all), N);
+    ck_assert_int_eq(intersectionIntSet(set, evens), N/2);
+  }
+  int i = 0;
+  for (const void *iter = newIntSetIterator(set); iter != NULL;
+       iter = stepIntSetIterator(iter)) {
+    ck_assert_int_eq(intSetIteratorElement(iter), i);
+    i += 2;
+  }
+  ck_assert_int_eq(i, N);
+  freeIntSet(set);
+  freeIntSet(evens);
+  freeIntSet(all);
+}
+END_TEST
+
+/** Return # of elements seen by iterating over set */
+static int
+iterationCount(void *set)
+{
+  int n = 0;
+  for (const void *iter = newIntSetIterator(set); iter != NULL;
+       iter = stepIntSetIterator(iter)) {
+    n++;
+  }
+  return n;
+}
+
+START_TEST(chainedOpsKeepCount)
+{
+  void *set = newIntSet();
+  void *other = newIntSet();
+  for (int k = 1; k <= 20; k++) {
+    for (int i = 0; i < 50; i++) addIntSet(other, i * k);
+    int n = (k % 2) ? unionIntSet(set, other) : intersectionIntSet(set, other);
+    ck_assert_int_eq(n, iterationCount(set));
+    ck_assert_int_eq(nElementsIntSet(set), n);
+    ck_assert_int_eq(unionIntSet(set, set), n);
+    ck_assert_int_eq(intersectionIntSet(set, set), n);
+  }
+  freeIntSet(set);
+  freeIntSet(other);
+}
+END_TEST
+
 static Suite *
 intersectionIntSetSuite(void)
 {
@@ -603,11 +810,1497 @@ intersectionIntSetSuite(void)
   tcase_add_test(intersectionTests, no_match_intersection);
   tcase_add_test(intersectionTests, all_match_intersection);
   tcase_add_test(intersectionTests, A_has_1_and_only_matched_intersection);
+  tcase_add_test(intersectionTests, intersectionThenUnionReusesNodes);
+  tcase_add_test(intersectionTests, chainedOpsKeepCount);
 
     suite_add_tcase(suite, intersectionTests);
   return suite;
 }
 
+/************************* Array Backend Tests *************************/
+
+START_TEST(arrayAddContains)
+{
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  ck_assert_ptr_ne(set, NULL);
+  const int elements[] = { 33, 53, 33, -54, 2, 53 };
+  const int nElements = sizeof(elements)/sizeof(elements[0]);
+  int n = addMultipleIntSet(set, elements, nElements);
+  ck_assert_int_eq(n, 4);
+  ck_assert_int_eq(nElementsIntSet(set), 4);
+  for (int i = 0; i < nElements; i++) {
+    ck_assert_int_eq(isInIntSet(set, elements[i]), 1);
+  }
+  ck_assert_int_eq(isInIntSet(set, 0), 0);
+  ck_assert_int_eq(isInIntSet(set, 100), 0);
+  ck_assert_int_eq(isInIntSet(set, -100), 0);
+  freeIntSet(set);
+}
+END_TEST
+
+START_TEST(arrayManyElementsIter)
+{
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  const int LO = -1000; //inclusive
+  const int HI = 1000;  //exclusive
+  const int K = 5;
+  for (int k = K - 1; k >= 0; k--) {
+    for (int i = LO; i < HI; i += K) addIntSet(set, i + k);
+  }
+  ck_assert_int_eq(nElementsIntSet(set), HI - LO);
+  int i = LO;
+  for (const void *iter = newIntSetIterator(set); iter != NULL;
+       iter = stepIntSetIterator(iter)) {
+    int v = intSetIteratorElement(iter);
+    ck_assert_int_eq(v, i++);
+  }
+  ck_assert_int_eq(i, HI);
+  freeIntSet(set);
+}
+END_TEST
+
+START_TEST(invalidBackend)
+{
+  ck_assert_ptr_eq(newBackendIntSet(N_INT_SET_BACKENDS), NULL);
+}
+END_TEST
+
+/** Check union and intersection of arr1 and arr2 for every combination
+ *  of backends.
+ */
+static void
+mixedBackendTest(const int arr1[], int nArr1, const int arr2[], int nArr2,
+                 const int unionArr[], int nUnionArr,
+                 const int intersectionArr[], int nIntersectionArr)
+{
+  for (int b1 = 0; b1 < N_INT_SET_BACKENDS; b1++) {
+    for (int b2 = 0; b2 < N_INT_SET_BACKENDS; b2++) {
+      for (int isUnion = 0; isUnion <= 1; isUnion++) {
+        void *set1 = newBackendIntSet(b1);
+        addMultipleIntSet(set1, arr1, nArr1);
+        void *set2 = newBackendIntSet(b2);
+        addMultipleIntSet(set2, arr2, nArr2);
+        const int *expected = isUnion ? unionArr : intersectionArr;
+        int nExpected = isUnion ? nUnionArr : nIntersectionArr;
+        int n = (isUnion ? unionIntSet : intersectionIntSet)(set1, set2);
+        ck_assert_int_eq(n, nExpected);
+        ck_assert_int_eq(nElementsIntSet(set1), nExpected);
+        int i = 0;
+        for (const void *iter = newIntSetIterator(set1); iter != NULL;
+             iter = stepIntSetIterator(iter)) {
+          ck_assert_int_eq(intSetIteratorElement(iter), expected[i++]);
+        }
+        ck_assert_int_eq(i, nExpected);
+        freeIntSet(set1);
+        freeIntSet(set2);
+      }
+    }
+  }
+}
+
+START_TEST(mixedBackendsInterleaved)
+{
+  mixedBackendTest((int[]) { 1, 33, 54, 3, 45 }, 5,
+                   (int[]) { 1, 3, 33, 45, 2, 53, 53 }, 7,
+                   (int[]) { 1, 2, 3, 33, 45, 53, 54 }, 7,
+                   (int[]) { 1, 3, 33, 45 }, 4);
+}
+END_TEST
+
+START_TEST(mixedBackendsEmpty)
+{
+  mixedBackendTest(NULL, 0, (int[]) { 4, 2 }, 2,
+                   (int[]) { 2, 4 }, 2, NULL, 0);
+  mixedBackendTest((int[]) { 4, 2 }, 2, NULL, 0,
+                   (int[]) { 2, 4 }, 2, NULL, 0);
+}
+END_TEST
+
+static Suite *
+arrayBackendSuite(void)
+{
+  Suite *suite = suite_create("arrayBackend");
+  TCase *tests = tcase_create("array");
+  tcase_add_test(tests, arrayAddContains);
+  tcase_add_test(tests, arrayManyElementsIter);
+  tcase_add_test(tests, invalidBackend);
+  tcase_add_test(tests, mixedBackendsInterleaved);
+  tcase_add_test(tests, mixedBackendsEmpty);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************ Bitmap Backend Tests *************************/
+
+/** Add to set elements spread over several 2**16 chunks: a dense
+ *  chunk, a chunk of runs, a sparse chunk and the extreme values.
+ *  offset shifts the dense and run ranges so that two such sets
+ *  partially overlap.
+ */
+static void
+addBitmapTestElements(void *set, int offset)
+{
+  for (int i = 0; i < 20000; i += 3) addIntSet(set, offset + i);
+  int runs[3000];
+  int nRuns = 0;
+  for (int i = 0; i < 30; i++) {
+    for (int j = 0; j < 100; j++) runs[nRuns++] = 200000 + offset + 1000*i + j;
+  }
+  addMultipleIntSet(set, runs, nRuns);
+  for (int i = -5; i <= 5; i++) addIntSet(set, i * 70001);
+  addIntSet(set, INT_MIN);
+  addIntSet(set, INT_MAX);
+}
+
+START_TEST(bitmapMatchesArray)
+{
+  void *bitmap = newBackendIntSet(BITMAP_INT_SET);
+  void *array = newBackendIntSet(ARRAY_INT_SET);
+  addBitmapTestElements(bitmap, 0);
+  addBitmapTestElements(array, 0);
+  checkSameElements(bitmap, array);
+  ck_assert_int_eq(isInIntSet(bitmap, INT_MIN), 1);
+  ck_assert_int_eq(isInIntSet(bitmap, INT_MAX), 1);
+  ck_assert_int_eq(isInIntSet(bitmap, 3000), 1);
+  ck_assert_int_eq(isInIntSet(bitmap, 3001), 0);
+  ck_assert_int_eq(isInIntSet(bitmap, 229099), 1);
+  ck_assert_int_eq(isInIntSet(bitmap, 229100), 0);
+  ck_assert_int_eq(isInIntSet(bitmap, -70001), 1);
+  ck_assert_int_eq(isInIntSet(bitmap, -70000), 0);
+  //adding an element already in a run chunk leaves it unchanged
+  int n = nElementsIntSet(bitmap);
+  ck_assert_int_eq(addIntSet(bitmap, 200050), n);
+  ck_assert_int_eq(addIntSet(bitmap, 200150), n + 1);
+  ck_assert_int_eq(addIntSet(array, 200150), n + 1);
+  checkSameElements(bitmap, array);
+  freeIntSet(bitmap);
+  freeIntSet(array);
+}
+END_TEST
+
+START_TEST(bitmapUnionIntersection)
+{
+  for (int isUnion = 0; isUnion <= 1; isUnion++) {
+    void *bitmap1 = newBackendIntSet(BITMAP_INT_SET);
+    void *bitmap2 = newBackendIntSet(BITMAP_INT_SET);
+    void *array1 = newBackendIntSet(ARRAY_INT_SET);
+    void *array2 = newBackendIntSet(ARRAY_INT_SET);
+    addBitmapTestElements(bitmap1, 0);
+    addBitmapTestElements(bitmap2, 50);
+    addBitmapTestElements(array1, 0);
+    addBitmapTestElements(array2, 50);
+    int (*op)(void *, void *) = isUnion ? unionIntSet : intersectionIntSet;
+    int n = op(bitmap1, bitmap2);
+    ck_assert_int_eq(op(array1, array2), n);
+    checkSameElements(bitmap1, array1);
+    freeIntSet(bitmap1);
+    freeIntSet(bitmap2);
+    freeIntSet(array1);
+    freeIntSet(array2);
+  }
+}
+END_TEST
+
+START_TEST(bitmapDenseChunk)
+{
+  //fill a whole chunk so that it must switch from array to bitmap
+  void *set = newBackendIntSet(BITMAP_INT_SET);
+  for (int i = 0; i < 65536; i++) addIntSet(set, -i);
+  ck_assert_int_eq(nElementsIntSet(set), 65536);
+  ck_assert_int_eq(isInIntSet(set, -65535), 1);
+  ck_assert_int_eq(isInIntSet(set, -65536), 0);
+  ck_assert_int_eq(isInIntSet(set, 1), 0);
+  int i = -65535;
+  for (const void *iter = newIntSetIterator(set); iter != NULL;
+       iter = stepIntSetIterator(iter)) {
+    ck_assert_int_eq(intSetIteratorElement(iter), i++);
+  }
+  ck_assert_int_eq(i, 1);
+  freeIntSet(set);
+}
+END_TEST
+
+static Suite *
+bitmapBackendSuite(void)
+{
+  Suite *suite = suite_create("bitmapBackend");
+  TCase *tests = tcase_create("bitmap");
+  tcase_add_test(tests, bitmapMatchesArray);
+  tcase_add_test(tests, bitmapUnionIntersection);
+  tcase_add_test(tests, bitmapDenseChunk);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************** Hash Backend Tests *************************/
+
+START_TEST(hashMatchesArray)
+{
+  void *hash = newBackendIntSet(HASH_INT_SET);
+  void *array = newBackendIntSet(ARRAY_INT_SET);
+  //values sharing low bits, and pseudo-random ones with repeats
+  for (int i = -2000; i < 2000; i++) {
+    ck_assert_int_eq(addIntSet(hash, i * 65536), addIntSet(array, i * 65536));
+  }
+  unsigned seed = 7;
+  for (int i = 0; i < 100000; i++) {
+    seed = seed * 1103515245 + 12345;
+    int v = (int)seed >> (i % 8);
+    ck_assert_int_eq(addIntSet(hash, v), addIntSet(array, v));
+  }
+  addIntSet(hash, INT_MIN);
+  addIntSet(array, INT_MIN);
+  for (int i = -3000; i < 3000; i++) {
+    ck_assert_int_eq(isInIntSet(hash, i * 65536), isInIntSet(array, i * 65536));
+    ck_assert_int_eq(isInIntSet(hash, i), isInIntSet(array, i));
+  }
+  checkSameElements(hash, array);
+  freeIntSet(hash);
+  freeIntSet(array);
+}
+END_TEST
+
+START_TEST(hashSortsAfterChange)
+{
+  void *set = newBackendIntSet(HASH_INT_SET);
+  ck_assert_ptr_eq(newIntSetIterator(set), NULL);
+  ck_assert_int_eq(isInIntSet(set, 0), 0);
+  ck_assert_int_eq(addMultipleIntSet(set, (int[]) { 9, -4, 9, 2 }, 4), 3);
+  checkElements(set, (int[]) { -4, 2, 9 }, 3);
+  //a change after iteration must be reflected by the next iteration
+  addIntSet(set, 5);
+  checkElements(set, (int[]) { -4, 2, 5, 9 }, 4);
+  int element;
+  ck_assert_int_eq(selectIntSet(set, 2, &element), 0);
+  ck_assert_int_eq(element, 5);
+  void *other = newIntSet();
+  addMultipleIntSet(other, (int[]) { -4, 5, 7 }, 3);
+  ck_assert_int_eq(intersectionIntSet(set, other), 2);
+  checkElements(set, (int[]) { -4, 5 }, 2);
+  ck_assert_int_eq(isInIntSet(set, 9), 0);
+  ck_assert_int_eq(addIntSet(set, 9), 3);
+  ck_assert_int_eq(unionIntSet(set, other), 4);
+  checkElements(set, (int[]) { -4, 5, 7, 9 }, 4);
+  freeIntSet(other);
+  freeIntSet(set);
+}
+END_TEST
+
+static Suite *
+hashBackendSuite(void)
+{
+  Suite *suite = suite_create("hashBackend");
+  TCase *tests = tcase_create("hash");
+  tcase_add_test(tests, hashMatchesArray);
+  tcase_add_test(tests, hashSortsAfterChange);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/*********************** Non-Destructive Op Tests **********************/
+
+typedef void *NewSetOp(void *intSetA, void *intSetB);
+
+/** Check newOp(set1, set2) against expected[nExpected] for every
+ *  combination of backends, and that set1 and set2 are unchanged.
+ *  arr1[] and arr2[] must be strictly increasing.
+ */
+static void
+newSetOpTest(NewSetOp *newOp, const int arr1[], int nArr1,
+             const int arr2[], int nArr2,
+             const int expected[], int nExpected)
+{
+  for (int b1 = 0; b1 < N_INT_SET_BACKENDS; b1++) {
+    for (int b2 = 0; b2 < N_INT_SET_BACKENDS; b2++) {
+      void *set1 = newBackendIntSet(b1);
+      addMultipleIntSet(set1, arr1, nArr1);
+      void *set2 = newBackendIntSet(b2);
+      addMultipleIntSet(set2, arr2, nArr2);
+      void *result = newOp(set1, set2);
+      ck_assert_ptr_ne(result, NULL);
+      checkElements(result, expected, nExpected);
+      checkElements(set1, arr1, nArr1);
+      checkElements(set2, arr2, nArr2);
+      //result is independent of its inputs
+      freeIntSet(set1);
+      freeIntSet(set2);
+      addIntSet(result, INT_MAX);
+      ck_assert_int_eq(isInIntSet(result, INT_MAX), 1);
+      freeIntSet(result);
+    }
+  }
+}
+
+static const int OPS_A[] = { -7, 1, 3, 33, 45, 54 };
+static const int OPS_B[] = { 1, 2, 3, 45, 53 };
+enum { N_OPS_A = sizeof(OPS_A)/sizeof(OPS_A[0]),
+       N_OPS_B = sizeof(OPS_B)/sizeof(OPS_B[0]) };
+
+START_TEST(newUnion)
+{
+  newSetOpTest(newUnionIntSet, OPS_A, N_OPS_A, OPS_B, N_OPS_B,
+               (int[]) { -7, 1, 2, 3, 33, 45, 53, 54 }, 8);
+  newSetOpTest(newUnionIntSet, NULL, 0, OPS_B, N_OPS_B, OPS_B, N_OPS_B);
+}
+END_TEST
+
+START_TEST(newIntersection)
+{
+  newSetOpTest(newIntersectionIntSet, OPS_A, N_OPS_A, OPS_B, N_OPS_B,
+               (int[]) { 1, 3, 45 }, 3);
+  newSetOpTest(newIntersectionIntSet, OPS_A, N_OPS_A, NULL, 0, NULL, 0);
+}
+END_TEST
+
+START_TEST(newDifference)
+{
+  newSetOpTest(newDifferenceIntSet, OPS_A, N_OPS_A, OPS_B, N_OPS_B,
+               (int[]) { -7, 33, 54 }, 3);
+  newSetOpTest(newDifferenceIntSet, OPS_B, N_OPS_B, OPS_A, N_OPS_A,
+               (int[]) { 2, 53 }, 2);
+  newSetOpTest(newDifferenceIntSet, OPS_A, N_OPS_A, OPS_A, N_OPS_A,
+               NULL, 0);
+}
+END_TEST
+
+START_TEST(newSymDiff)
+{
+  newSetOpTest(newSymDiffIntSet, OPS_A, N_OPS_A, OPS_B, N_OPS_B,
+               (int[]) { -7, 2, 33, 53, 54 }, 5);
+  newSetOpTest(newSymDiffIntSet, NULL, 0, OPS_A, N_OPS_A, OPS_A, N_OPS_A);
+}
+END_TEST
+
+static Suite *
+newSetOpSuite(void)
+{
+  Suite *suite = suite_create("newSetOps");
+  TCase *tests = tcase_create("newSetOps");
+  tcase_add_test(tests, newUnion);
+  tcase_add_test(tests, newIntersection);
+  tcase_add_test(tests, newDifference);
+  tcase_add_test(tests, newSymDiff);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************* Multi-Way Op Tests **************************/
+
+enum { MANY_RANGE = 2000, MAX_MANY_SETS = 7 };
+
+/** Check intersectManyIntSet() and unionManyIntSet() on sets[k], where
+ *  sets[i] holds the multiples of i + 2 in [-MANY_RANGE, MANY_RANGE)
+ *  and uses backend (i + backendOffset) % N_INT_SET_BACKENDS.
+ */
+static void
+manyOpsTest(int k, int backendOffset)
+{
+  void *sets[MAX_MANY_SETS];
+  for (int i = 0; i < k; i++) {
+    sets[i] = newBackendIntSet((i + backendOffset) % N_INT_SET_BACKENDS);
+    for (int v = -MANY_RANGE; v < MANY_RANGE; v++) {
+      if (v % (i + 2) == 0) addIntSet(sets[i], v);
+    }
+  }
+  void *intersection = intersectManyIntSet(sets, k);
+  void *union_ = unionManyIntSet(sets, k);
+  ck_assert_ptr_ne(intersection, NULL);
+  ck_assert_ptr_ne(union_, NULL);
+  int nIntersection = 0, nUnion = 0;
+  for (int v = -MANY_RANGE; v < MANY_RANGE; v++) {
+    int nIn = 0;
+    for (int i = 0; i < k; i++) nIn += isInIntSet(sets[i], v);
+    ck_assert_int_eq(isInIntSet(intersection, v), nIn == k);
+    ck_assert_int_eq(isInIntSet(union_, v), nIn > 0);
+    nIntersection += nIn == k;
+    nUnion += nIn > 0;
+  }
+  ck_assert_int_eq(nElementsIntSet(intersection), nIntersection);
+  ck_assert_int_eq(nElementsIntSet(union_), nUnion);
+  ck_assert_int_eq(iterationCount(intersection), nIntersection);
+  ck_assert_int_eq(iterationCount(union_), nUnion);
+  freeIntSet(intersection);
+  freeIntSet(union_);
+  for (int i = 0; i < k; i++) freeIntSet(sets[i]);
+}
+
+START_TEST(manyOps)
+{
+  for (int k = 1; k <= MAX_MANY_SETS; k++) {
+    for (int b = 0; b < N_INT_SET_BACKENDS; b++) manyOpsTest(k, b);
+  }
+}
+END_TEST
+
+START_TEST(manyOpsWithEmpty)
+{
+  void *sets[] = { newIntSet(), newBackendIntSet(ARRAY_INT_SET), newIntSet() };
+  addMultipleIntSet(sets[0], (int[]) { 1, 2, 3 }, 3);
+  addMultipleIntSet(sets[2], (int[]) { 3, 4 }, 2);
+  void *intersection = intersectManyIntSet(sets, 3);
+  void *union_ = unionManyIntSet(sets, 3);
+  checkElements(intersection, NULL, 0);
+  checkElements(union_, (int[]) { 1, 2, 3, 4 }, 4);
+  ck_assert_ptr_eq(intersectManyIntSet(sets, 0), NULL);
+  ck_assert_ptr_eq(unionManyIntSet(sets, 0), NULL);
+  freeIntSet(intersection);
+  freeIntSet(union_);
+  for (int i = 0; i < 3; i++) freeIntSet(sets[i]);
+}
+END_TEST
+
+static Suite *
+manyOpSuite(void)
+{
+  Suite *suite = suite_create("manyOps");
+  TCase *tests = tcase_create("manyOps");
+  tcase_add_test(tests, manyOps);
+  tcase_add_test(tests, manyOpsWithEmpty);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************* Parallel Set Op Tests ***********************/
+
+typedef void *NewParallelOp(void *intSetA, void *intSetB, int nThreads);
+
+/** Return a new set with backend holding n elements: runs of
+ *  consecutive values at pseudo-random starts spread over all ints,
+ *  followed by pseudo-random values with repeats.
+ */
+static void *
+newParallelTestSet(IntSetBackend backend, int n, unsigned seed)
+{
+  int *elements = malloc(n * sizeof(int));
+  ck_assert_ptr_ne(elements, NULL);
+  int start = 0;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 1103515245 + 12345;
+    if (i < n/2) {
+      if (i % 100 == 0) start = (int)seed;
+      elements[i] = start + i % 100;
+    }
+    else {
+      elements[i] = (int)seed >> (i % 12);
+    }
+  }
+  void *set = newBackendIntSet(backend);
+  ck_assert_int_ge(addMultipleIntSet(set, elements, n), 0);
+  free(elements);
+  return set;
+}
+
+/** Check that parallelOp gives the same result as sequentialOp on large
+ *  sets of various backends, for various # of threads.
+ */
+static void
+parallelOpTest(NewParallelOp *parallelOp, NewSetOp *sequentialOp)
+{
+  enum { N = 150000 }; //more than a part's worth per thread
+  const IntSetBackend backends[] = { ARRAY_INT_SET, BITMAP_INT_SET, HASH_INT_SET };
+  const int threads[] = { 1, 2, 3, 8, 0 };
+  for (int b1 = 0; b1 < 3; b1++) {
+    for (int b2 = 0; b2 < 3; b2++) {
+      void *set1 = newParallelTestSet(backends[b1], N, 1);
+      void *set2 = newParallelTestSet(backends[b2], N, b1 == b2 ? 1 : 2);
+      void *expected = sequentialOp(set1, set2);
+      for (int t = 0; t < sizeof(threads)/sizeof(threads[0]); t++) {
+        void *result = parallelOp(set1, set2, threads[t]);
+        ck_assert_ptr_ne(result, NULL);
+        checkSameElements(result, expected);
+        addIntSet(result, INT_MIN);
+        ck_assert_int_eq(isInIntSet(result, INT_MIN), 1);
+        freeIntSet(result);
+      }
+      freeIntSet(expected);
+      freeIntSet(set1);
+      freeIntSet(set2);
+    }
+  }
+}
+
+START_TEST(parallelUnion)
+{
+  parallelOpTest(newParallelUnionIntSet, newUnionIntSet);
+}
+END_TEST
+
+START_TEST(parallelIntersection)
+{
+  parallelOpTest(newParallelIntersectionIntSet, newIntersectionIntSet);
+}
+END_TEST
+
+START_TEST(parallelDifference)
+{
+  parallelOpTest(newParallelDifferenceIntSet, newDifferenceIntSet);
+}
+END_TEST
+
+START_TEST(parallelSmallAndInvalid)
+{
+  void *set1 = newBackendIntSet(BITMAP_INT_SET);
+  void *set2 = newBackendIntSet(ARRAY_INT_SET);
+  addMultipleIntSet(set1, OPS_A, N_OPS_A);
+  addMultipleIntSet(set2, OPS_B, N_OPS_B);
+  void *union_ = newParallelUnionIntSet(set1, set2, 4);
+  checkElements(union_, (int[]) { -7, 1, 2, 3, 33, 45, 53, 54 }, 8);
+  errno = 0;
+  ck_assert_ptr_eq(newParallelDifferenceIntSet(set1, set2, -1), NULL);
+  ck_assert_int_eq(errno, EINVAL);
+  freeIntSet(union_);
+  freeIntSet(set1);
+  freeIntSet(set2);
+}
+END_TEST
+
+static Suite *
+parallelSuite(void)
+{
+  Suite *suite = suite_create("parallelOps");
+  TCase *tests = tcase_create("parallelOps");
+  tcase_add_test(tests, parallelUnion);
+  tcase_add_test(tests, parallelIntersection);
+  tcase_add_test(tests, parallelDifference);
+  tcase_add_test(tests, parallelSmallAndInvalid);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************* Concurrent Set Tests ************************/
+
+START_TEST(concurrentAddContains)
+{
+  void *set = newConcurrentIntSet();
+  ck_assert_ptr_ne(set, NULL);
+  ck_assert_int_eq(addConcurrentIntSet(set, 5), 1);
+  ck_assert_int_eq(addConcurrentIntSet(set, -3), 2);
+  ck_assert_int_eq(addConcurrentIntSet(set, 5), 2);
+  ck_assert_int_eq(addMultipleConcurrentIntSet(set, (int[]) { 9, -3, 1, 9 }, 4),
+                   4);
+  ck_assert_int_eq(nElementsConcurrentIntSet(set), 4);
+  ck_assert_int_eq(isInConcurrentIntSet(set, 1), 1);
+  ck_assert_int_eq(isInConcurrentIntSet(set, 2), 0);
+  void *snapshot = snapshotConcurrentIntSet(set);
+  addConcurrentIntSet(set, 2);
+  checkElements(snapshot, (int[]) { -3, 1, 5, 9 }, 4);
+  freeIntSet(snapshot);
+  freeConcurrentIntSet(set);
+}
+END_TEST
+
+enum { CONCURRENT_RANGE = 4000, N_READERS = 4 };
+
+typedef struct {
+  void *set;
+  atomic_int *isDone;
+  int nErrors;
+} ReaderArgs;
+
+/** Repeatedly check that every odd value in [0, CONCURRENT_RANGE) is
+ *  present and no value outside it is, until *isDone.
+ */
+static void *
+concurrentReader(void *p)
+{
+  ReaderArgs *args = p;
+  unsigned seed = 1;
+  while (!atomic_load(args->isDone)) {
+    seed = seed * 1103515245 + 12345;
+    int v = (seed >> 8) % CONCURRENT_RANGE;
+    if ((v % 2 == 1) && !isInConcurrentIntSet(args->set, v)) args->nErrors++;
+    if (isInConcurrentIntSet(args->set, v + CONCURRENT_RANGE)) args->nErrors++;
+    if (nElementsConcurrentIntSet(args->set) < CONCURRENT_RANGE/2) {
+      args->nErrors++;
+    }
+  }
+  return NULL;
+}
+
+START_TEST(concurrentReadersAndWriter)
+{
+  void *set = newConcurrentIntSet();
+  for (int v = 1; v < CONCURRENT_RANGE; v += 2) addConcurrentIntSet(set, v);
+  atomic_int isDone = 0;
+  pthread_t readers[N_READERS];
+  ReaderArgs args[N_READERS];
+  for (int i = 0; i < N_READERS; i++) {
+    args[i] = (ReaderArgs) { .set = set, .isDone = &isDone };
+    pthread_create(&readers[i], NULL, concurrentReader, &args[i]);
+  }
+  //add half the evens one at a time, the rest in one batch
+  for (int v = 0; v < CONCURRENT_RANGE/2; v += 2) addConcurrentIntSet(set, v);
+  int evens[CONCURRENT_RANGE/4];
+  for (int i = 0; i < CONCURRENT_RANGE/4; i++) {
+    evens[i] = CONCURRENT_RANGE/2 + 2*i;
+  }
+  addMultipleConcurrentIntSet(set, evens, CONCURRENT_RANGE/4);
+  atomic_store(&isDone, 1);
+  for (int i = 0; i < N_READERS; i++) {
+    pthread_join(readers[i], NULL);
+    ck_assert_int_eq(args[i].nErrors, 0);
+  }
+  ck_assert_int_eq(nElementsConcurrentIntSet(set), CONCURRENT_RANGE);
+  for (int v = 0; v < CONCURRENT_RANGE; v++) {
+    ck_assert_int_eq(isInConcurrentIntSet(set, v), 1);
+  }
+  freeConcurrentIntSet(set);
+}
+END_TEST
+
+static Suite *
+concurrentSuite(void)
+{
+  Suite *suite = suite_create("concurrent");
+  TCase *tests = tcase_create("concurrent");
+  tcase_add_test(tests, concurrentAddContains);
+  tcase_add_test(tests, concurrentReadersAndWriter);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************* Persistent Set Tests ************************/
+
+/** Check that version has exactly the elements of set */
+static void
+checkPersistent(const void *version, void *set)
+{
+  void *copy = newIntSetFromPersistent(version, ARRAY_INT_SET);
+  ck_assert_ptr_ne(copy, NULL);
+  checkSameElements(copy, set);
+  ck_assert_int_eq(nElementsPersistentIntSet(version), nElementsIntSet(set));
+  freeIntSet(copy);
+}
+
+START_TEST(persistentVersions)
+{
+  //enough elements for a tree of 3 levels
+  enum { N = 100000, N_KEPT = 10 };
+  const void *kept[N_KEPT];
+  void *keptSets[N_KEPT];
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  void *version = newPersistentIntSet();
+  ck_assert_int_eq(nElementsPersistentIntSet(version), 0);
+  ck_assert_int_eq(isInPersistentIntSet(version, 0), 0);
+  unsigned seed = 5;
+  for (int i = 0; i < N; i++) {
+    if (i % (N / N_KEPT) == 0) {
+      int k = i / (N / N_KEPT);
+      checkPersistent(version, set);
+      kept[k] = retainPersistentIntSet(version);
+      keptSets[k] = newIntSetFromPersistent(version, ARRAY_INT_SET);
+    }
+    seed = seed * 1103515245 + 12345;
+    int v = (int)seed >> (i % 16); //repeats among the small values
+    void *next = addPersistentIntSet(version, v);
+    ck_assert_ptr_ne(next, NULL);
+    addIntSet(set, v);
+    ck_assert_int_eq(isInPersistentIntSet(next, v), 1);
+    ck_assert_int_eq(nElementsPersistentIntSet(next), nElementsIntSet(set));
+    freePersistentIntSet(version);
+    version = next;
+  }
+  checkPersistent(version, set);
+  //old versions are unaffected by the later additions
+  for (int k = 0; k < N_KEPT; k++) {
+    checkPersistent(kept[k], keptSets[k]);
+    freePersistentIntSet(kept[k]);
+    freeIntSet(keptSets[k]);
+  }
+  freePersistentIntSet(version);
+  freeIntSet(set);
+}
+END_TEST
+
+START_TEST(persistentAddMultiple)
+{
+  enum { N_BASE = 10000, N_FEW = 20, N_MANY = 30000 };
+  int *elements = malloc(N_MANY * sizeof(int));
+  for (int i = 0; i < N_MANY; i++) elements[i] = (i * 7919) % N_MANY - N_BASE;
+  void *empty = newPersistentIntSet();
+  void *stillEmpty = addMultiplePersistentIntSet(empty, elements, 0);
+  ck_assert_int_eq(nElementsPersistentIntSet(stillEmpty), 0);
+  void *base = addMultiplePersistentIntSet(empty, elements, N_BASE);
+  freePersistentIntSet(stillEmpty);
+  freePersistentIntSet(empty);
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  addMultipleIntSet(set, elements, N_BASE);
+  checkPersistent(base, set);
+  //a few additions are made one by one, many by a rebuild
+  const int counts[] = { N_FEW, N_MANY };
+  for (int c = 0; c < 2; c++) {
+    void *version = addMultiplePersistentIntSet(base, elements, counts[c]);
+    ck_assert_ptr_ne(version, NULL);
+    void *expected = newBackendIntSet(ARRAY_INT_SET);
+    addMultipleIntSet(expected, elements, N_BASE);
+    addMultipleIntSet(expected, elements, counts[c]);
+    checkPersistent(version, expected);
+    void *next = addPersistentIntSet(version, INT_MAX);
+    addIntSet(expected, INT_MAX);
+    checkPersistent(next, expected);
+    freePersistentIntSet(next);
+    freePersistentIntSet(version);
+    freeIntSet(expected);
+  }
+  checkPersistent(base, set);
+  freePersistentIntSet(base);
+  freeIntSet(set);
+  free(elements);
+}
+END_TEST
+
+enum { N_PERSISTENT_WRITERS = 4, PERSISTENT_RANGE = 5000 };
+
+typedef struct {
+  const void *base;  //version shared by all writers
+  int id;
+  int nErrors;
+} WriterArgs;
+
+/** Add a range of values of its own to a snapshot of args->base, one
+ *  version at a time, checking base is unchanged meanwhile.
+ */
+static void *
+persistentWriter(void *p)
+{
+  WriterArgs *args = p;
+  void *version = retainPersistentIntSet(args->base);
+  int n = nElementsPersistentIntSet(args->base);
+  int lo = (args->id + 1) * PERSISTENT_RANGE;
+  for (int v = lo; v < lo + PERSISTENT_RANGE; v++) {
+    void *next = addPersistentIntSet(version, v);
+    freePersistentIntSet(version);
+    if (!(version = next)) {
+      args->nErrors++;
+      return NULL;
+    }
+    if (isInPersistentIntSet(args->base, v)) args->nErrors++;
+  }
+  if (nElementsPersistentIntSet(version) != n + PERSISTENT_RANGE) {
+    args->nErrors++;
+  }
+  if (nElementsPersistentIntSet(args->base) != n) args->nErrors++;
+  freePersistentIntSet(version);
+  return NULL;
+}
+
+START_TEST(persistentThreads)
+{
+  void *base = newPersistentIntSet();
+  for (int v = 0; v < PERSISTENT_RANGE; v++) {
+    void *next = addPersistentIntSet(base, v);
+    freePersistentIntSet(base);
+    base = next;
+  }
+  pthread_t writers[N_PERSISTENT_WRITERS];
+  WriterArgs args[N_PERSISTENT_WRITERS];
+  for (int i = 0; i < N_PERSISTENT_WRITERS; i++) {
+    args[i] = (WriterArgs) { .base = base, .id = i };
+    pthread_create(&writers[i], NULL, persistentWriter, &args[i]);
+  }
+  for (int i = 0; i < N_PERSISTENT_WRITERS; i++) {
+    pthread_join(writers[i], NULL);
+    ck_assert_int_eq(args[i].nErrors, 0);
+  }
+  ck_assert_int_eq(nElementsPersistentIntSet(base), PERSISTENT_RANGE);
+  freePersistentIntSet(base);
+}
+END_TEST
+
+static Suite *
+persistentSuite(void)
+{
+  Suite *suite = suite_create("persistent");
+  TCase *tests = tcase_create("persistent");
+  tcase_add_test(tests, persistentVersions);
+  tcase_add_test(tests, persistentAddMultiple);
+  tcase_add_test(tests, persistentThreads);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/**************************** Int-Set File Tests ***********************/
+
+/** Set path[size] to a fresh temporary file name for name */
+static void
+tempPath(char path[], int size, const char *name)
+{
+  snprintf(path, size, "/tmp/int-set-%s-%ld.bin", name, (long)getpid());
+}
+
+/** Fill set with elements which stress the packing: the extremes, runs,
+ *  small and very large gaps and more than one block.
+ */
+static void
+addFileTestElements(void *set)
+{
+  addMultipleIntSet(set, (int[]) { INT_MIN, INT_MIN + 1, -1, 0, INT_MAX }, 5);
+  for (int v = -1000; v < 1000; v += 3) addIntSet(set, v);
+  for (int v = 5000; v < 5400; v++) addIntSet(set, v);
+  for (int i = 1; i < 40; i++) addIntSet(set, i * (INT_MAX / 40));
+}
+
+START_TEST(fileRoundTrip)
+{
+  char path[64];
+  tempPath(path, sizeof(path), "round-trip");
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    void *set = newBackendIntSet(b);
+    addFileTestElements(set);
+    ck_assert_int_eq(writeIntSet(set, path), 0);
+    for (int b2 = 0; b2 < N_INT_SET_BACKENDS; b2++) {
+      void *read = readIntSet(path, b2);
+      ck_assert_ptr_ne(read, NULL);
+      checkSameElements(set, read);
+      freeIntSet(read);
+    }
+    freeIntSet(set);
+  }
+  remove(path);
+}
+END_TEST
+
+START_TEST(fileEmptyAndSingle)
+{
+  char path[64];
+  tempPath(path, sizeof(path), "small");
+  void *set = newIntSet();
+  ck_assert_int_eq(writeIntSet(set, path), 0);
+  void *mapped = openIntSetMapped(path);
+  ck_assert_ptr_ne(mapped, NULL);
+  checkElements(mapped, NULL, 0);
+  ck_assert_int_eq(isInIntSet(mapped, 0), 0);
+  freeIntSet(mapped);
+  addIntSet(set, -7);
+  ck_assert_int_eq(writeIntSet(set, path), 0);
+  mapped = openIntSetMapped(path);
+  checkElements(mapped, (int[]) { -7 }, 1);
+  ck_assert_int_eq(isInIntSet(mapped, -7), 1);
+  ck_assert_int_eq(isInIntSet(mapped, -8), 0);
+  freeIntSet(mapped);
+  freeIntSet(set);
+  remove(path);
+}
+END_TEST
+
+START_TEST(fileMappedLookup)
+{
+  char path[64];
+  tempPath(path, sizeof(path), "lookup");
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  addFileTestElements(set);
+  ck_assert_int_eq(writeIntSet(set, path), 0);
+  void *mapped = openIntSetMapped(path);
+  ck_assert_ptr_ne(mapped, NULL);
+  checkSameElements(set, mapped);
+  for (int v = -2000; v < 6000; v++) {
+    ck_assert_int_eq(isInIntSet(mapped, v), isInIntSet(set, v));
+  }
+  for (const void *iter = newIntSetIterator(set); iter != NULL;
+       iter = stepIntSetIterator(iter)) {
+    int v = intSetIteratorElement(iter);
+    ck_assert_int_eq(isInIntSet(mapped, v), 1);
+    if (v != INT_MAX) {
+      ck_assert_int_eq(isInIntSet(mapped, v + 1), isInIntSet(set, v + 1));
+    }
+  }
+  freeIntSet(mapped);
+  freeIntSet(set);
+  remove(path);
+}
+END_TEST
+
+START_TEST(fileMappedOperand)
+{
+  char path[64];
+  tempPath(path, sizeof(path), "operand");
+  void *set = newIntSet();
+  addMultipleIntSet(set, (int[]) { 1, 3, 5, 7 }, 4);
+  writeIntSet(set, path);
+  void *mapped = openIntSetMapped(path);
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    void *a = newBackendIntSet(b);
+    addMultipleIntSet(a, (int[]) { 2, 3, 4, 5 }, 4);
+    ck_assert_int_eq(unionIntSet(a, mapped), 6);
+    checkElements(a, (int[]) { 1, 2, 3, 4, 5, 7 }, 6);
+    freeIntSet(a);
+  }
+  void *difference = newDifferenceIntSet(mapped, set);
+  checkElements(difference, NULL, 0);
+  freeIntSet(difference);
+  errno = 0;
+  ck_assert_int_lt(addIntSet(mapped, 2), 0);
+  ck_assert_int_eq(errno, EROFS);
+  ck_assert_int_lt(unionIntSet(mapped, set), 0);
+  ck_assert_int_eq(nElementsIntSet(mapped), 4);
+  freeIntSet(mapped);
+  freeIntSet(set);
+  remove(path);
+}
+END_TEST
+
+START_TEST(fileInvalid)
+{
+  char path[64];
+  tempPath(path, sizeof(path), "invalid");
+  FILE *out = fopen(path, "wb");
+  fputs("not an int-set file at all", out);
+  fclose(out);
+  errno = 0;
+  ck_assert_ptr_eq(openIntSetMapped(path), NULL);
+  ck_assert_int_eq(errno, EINVAL);
+  ck_assert_ptr_eq(readIntSet(path, LIST_INT_SET), NULL);
+  //truncating a valid file must also be caught
+  void *set = newIntSet();
+  addFileTestElements(set);
+  writeIntSet(set, path);
+  freeIntSet(set);
+  ck_assert_int_eq(truncate(path, 200), 0);
+  ck_assert_ptr_eq(openIntSetMapped(path), NULL);
+  remove(path);
+  ck_assert_ptr_eq(openIntSetMapped(path), NULL);
+  ck_assert_int_eq(errno, ENOENT);
+}
+END_TEST
+
+static Suite *
+fileSuite(void)
+{
+  Suite *suite = suite_create("file");
+  TCase *tests = tcase_create("file");
+  tcase_add_test(tests, fileRoundTrip);
+  tcase_add_test(tests, fileEmptyAndSingle);
+  tcase_add_test(tests, fileMappedLookup);
+  tcase_add_test(tests, fileMappedOperand);
+  tcase_add_test(tests, fileInvalid);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/**************************** Order Query Tests ************************/
+
+/** Check every order query on set against its elements in expected[n]
+ *  (strictly increasing), probing each element and its neighbours.
+ */
+static void
+checkOrderQueries(void *set, const int expected[], int n)
+{
+  for (int k = 0; k < n; k++) {
+    int element;
+    ck_assert_int_eq(selectIntSet(set, k, &element), 0);
+    ck_assert_int_eq(element, expected[k]);
+    ck_assert_int_eq(rankIntSet(set, expected[k]), k);
+    if (expected[k] != INT_MAX) {
+      ck_assert_int_eq(rankIntSet(set, expected[k] + 1), k + 1);
+    }
+    int successor;
+    int hasSuccessor = successorIntSet(set, expected[k], &successor);
+    ck_assert_int_eq(hasSuccessor, k + 1 < n);
+    if (hasSuccessor) ck_assert_int_eq(successor, expected[k + 1]);
+    if (expected[k] != INT_MIN) {
+      const void *iter = newIntSetIteratorFrom(set, expected[k] - 1);
+      ck_assert_ptr_ne(iter, NULL);
+      int first = (k > 0 && expected[k - 1] == expected[k] - 1) ? k - 1 : k;
+      ck_assert_int_eq(intSetIteratorElement(iter), expected[first]);
+      int i = first;
+      for (; iter != NULL; iter = stepIntSetIterator(iter)) {
+        ck_assert_int_eq(intSetIteratorElement(iter), expected[i++]);
+      }
+      ck_assert_int_eq(i, n);
+    }
+  }
+  int element;
+  ck_assert_int_lt(selectIntSet(set, n, &element), 0);
+  ck_assert_int_eq(errno, EDOM);
+  ck_assert_int_lt(selectIntSet(set, -1, &element), 0);
+  ck_assert_int_eq(rankIntSet(set, INT_MIN), 0);
+  ck_assert_int_eq(rangeCountIntSet(set, INT_MIN, INT_MAX), n);
+  ck_assert_int_eq(rangeCountIntSet(set, 1, 0), 0);
+  if (n > 0) {
+    ck_assert_int_eq(rangeCountIntSet(set, expected[0], expected[n - 1]), n);
+    ck_assert_int_eq(rangeCountIntSet(set, expected[n/2], expected[n/2]), 1);
+    if (expected[n - 1] != INT_MAX) {
+      ck_assert_ptr_eq(newIntSetIteratorFrom(set, expected[n - 1] + 1), NULL);
+    }
+  }
+}
+
+/** Fill elements[] (room for ORDER_MAX) with a mix which gives a bitmap
+ *  set array, bitmap and run chunks; return their #.
+ */
+enum { ORDER_MAX = 16384 };
+static int
+orderTestElements(int elements[])
+{
+  int n = 0;
+  elements[n++] = INT_MIN;
+  for (int v = -300; v < 300; v += 7) elements[n++] = v;
+  for (int v = 70000; v < 72000; v++) elements[n++] = v;       //runs
+  for (int v = 200000; v < 200000 + 3*5000; v += 3) elements[n++] = v;
+  elements[n++] = INT_MAX - 1;
+  elements[n++] = INT_MAX;
+  return n;
+}
+
+START_TEST(orderQueries)
+{
+  int *expected = malloc(ORDER_MAX * sizeof(int));
+  int n = orderTestElements(expected);
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    void *set = newBackendIntSet(b);
+    checkOrderQueries(set, NULL, 0);
+    addMultipleIntSet(set, expected, n);
+    checkOrderQueries(set, expected, n);
+    freeIntSet(set);
+  }
+  char path[64];
+  tempPath(path, sizeof(path), "order");
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  addMultipleIntSet(set, expected, n);
+  writeIntSet(set, path);
+  void *mapped = openIntSetMapped(path);
+  checkOrderQueries(mapped, expected, n);
+  freeIntSet(mapped);
+  freeIntSet(set);
+  remove(path);
+  free(expected);
+}
+END_TEST
+
+START_TEST(orderQueriesAfterChange)
+{
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    void *set = newBackendIntSet(b);
+    addMultipleIntSet(set, (int[]) { 10, 20, 300000 }, 3);
+    ck_assert_int_eq(rankIntSet(set, 300000), 2);
+    addIntSet(set, 15);
+    addIntSet(set, 100000);
+    ck_assert_int_eq(rankIntSet(set, 300000), 4);
+    int element;
+    selectIntSet(set, 3, &element);
+    ck_assert_int_eq(element, 100000);
+    void *other = newIntSet();
+    addMultipleIntSet(other, (int[]) { 15, 20, 100000, 300000 }, 4);
+    intersectionIntSet(set, other);
+    ck_assert_int_eq(rankIntSet(set, 300000), 3);
+    ck_assert_int_eq(rangeCountIntSet(set, 16, 300000), 3);
+    freeIntSet(other);
+    freeIntSet(set);
+  }
+}
+END_TEST
+
+static Suite *
+orderQuerySuite(void)
+{
+  Suite *suite = suite_create("orderQueries");
+  TCase *tests = tcase_create("orderQueries");
+  tcase_add_test(tests, orderQueries);
+  tcase_add_test(tests, orderQueriesAfterChange);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************** Batch Iterator Tests ***********************/
+
+/** Check that batches of max from set reproduce expected[n] */
+static void
+checkBatches(void *set, const int expected[], int n, int max)
+{
+  int *batch = malloc(max * sizeof(int));
+  const void *iter = newIntSetIterator(set);
+  int i = 0;
+  for (int nBatch; (nBatch = nextBatchIntSet(&iter, batch, max)) > 0; ) {
+    ck_assert_int_le(nBatch, max);
+    ck_assert_int_le(i + nBatch, n);
+    for (int j = 0; j < nBatch; j++) ck_assert_int_eq(batch[j], expected[i++]);
+    ck_assert(nBatch == max || iter == NULL);
+  }
+  ck_assert_ptr_eq(iter, NULL);
+  ck_assert_int_eq(i, n);
+  free(batch);
+}
+
+/** Check batches of various sizes, and batches mixed with steps */
+static void
+checkBatchIteration(void *set, const int expected[], int n)
+{
+  int sizes[] = { 1, 3, 64, 1000, 5000, n > 0 ? n : 1, n + 1 };
+  for (int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+    checkBatches(set, expected, n, sizes[s]);
+  }
+  if (n < 3) return;
+  const void *iter = newIntSetIterator(set);
+  iter = stepIntSetIterator(iter);
+  int batch[2];
+  ck_assert_int_eq(nextBatchIntSet(&iter, batch, 2), 2);
+  ck_assert_int_eq(batch[0], expected[1]);
+  ck_assert_int_eq(batch[1], expected[2]);
+  if (n > 3) ck_assert_int_eq(intSetIteratorElement(iter), expected[3]);
+  freeIntSetIterator(iter);
+}
+
+START_TEST(batchIteration)
+{
+  int *expected = malloc(ORDER_MAX * sizeof(int));
+  int n = orderTestElements(expected);
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    void *set = newBackendIntSet(b);
+    int dummy;
+    const void *iter = newIntSetIterator(set);
+    ck_assert_int_eq(nextBatchIntSet(&iter, &dummy, 1), 0);
+    addMultipleIntSet(set, expected, n);
+    checkBatchIteration(set, expected, n);
+    //bitmap chunks which are not run-optimized
+    if (b == BITMAP_INT_SET) {
+      void *unoptimized = newBackendIntSet(b);
+      for (int i = 0; i < n; i++) addIntSet(unoptimized, expected[i]);
+      checkBatchIteration(unoptimized, expected, n);
+      freeIntSet(unoptimized);
+    }
+    freeIntSet(set);
+  }
+  char path[64];
+  tempPath(path, sizeof(path), "batch");
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  addMultipleIntSet(set, expected, n);
+  writeIntSet(set, path);
+  void *mapped = openIntSetMapped(path);
+  checkBatchIteration(mapped, expected, n);
+  freeIntSet(mapped);
+  freeIntSet(set);
+  remove(path);
+  free(expected);
+}
+END_TEST
+
+static Suite *
+batchIteratorSuite(void)
+{
+  Suite *suite = suite_create("batchIterator");
+  TCase *tests = tcase_create("batchIterator");
+  tcase_add_test(tests, batchIteration);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************** Memory Usage Tests *************************/
+
+START_TEST(memoryUsage)
+{
+  enum { N = 1000 };
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    void *set = newBackendIntSet(b);
+    ck_assert_uint_ge(memoryUsageIntSet(set), sizeof(Header));
+    size_t emptySize = memoryUsageIntSet(set);
+    for (int i = 0; i < N; i++) addIntSet(set, i * 1000003);
+    //every representation needs at least a byte per sparse element
+    ck_assert_uint_ge(memoryUsageIntSet(set), emptySize + N);
+    freeIntSet(set);
+  }
+  void *list = newIntSet();
+  for (int i = 0; i < N; i++) addIntSet(list, i);
+  ck_assert_uint_ge(memoryUsageIntSet(list), N * sizeof(Node));
+  //a union of overlapping sets keeps no room for the elements shared
+  void *array = newBackendIntSet(ARRAY_INT_SET);
+  for (int i = 0; i < N; i++) addIntSet(array, i);
+  void *unionSet = newUnionIntSet(array, list);
+  ck_assert_int_eq(nElementsIntSet(unionSet), N);
+  ck_assert_uint_eq(memoryUsageIntSet(unionSet),
+                    sizeof(Header) + N * sizeof(int));
+  freeIntSet(unionSet);
+  freeIntSet(array);
+  freeIntSet(list);
+}
+END_TEST
+
+/** Check that compactIntSet() on a set with backend holding
+ *  elements[n] keeps its elements, uses no more memory than before
+ *  nor than maxSize bytes, and leaves it usable.
+ */
+static void
+compactTest(IntSetBackend backend, const int elements[], int n, size_t maxSize)
+{
+  void *set = newBackendIntSet(backend);
+  for (int i = 0; i < n; i++) addIntSet(set, elements[i]);
+  void *expected = newBackendIntSet(ARRAY_INT_SET);
+  addMultipleIntSet(expected, elements, n);
+  size_t size = memoryUsageIntSet(set);
+  ck_assert_int_eq(compactIntSet(set), 0);
+  ck_assert_uint_le(memoryUsageIntSet(set), size);
+  ck_assert_uint_le(memoryUsageIntSet(set), maxSize);
+  checkSameElements(set, expected);
+  addIntSet(set, INT_MIN);
+  addIntSet(expected, INT_MIN);
+  checkSameElements(set, expected);
+  freeIntSet(set);
+  freeIntSet(expected);
+}
+
+START_TEST(compactDense)
+{
+  //a run of N values compacts to a few runs whatever its backend
+  enum { N = 100000 };
+  int *elements = malloc(N * sizeof(int));
+  for (int i = 0; i < N; i++) elements[i] = (i * 7919) % N - N/2;
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    compactTest(b, elements, N, sizeof(Header) + 1000);
+  }
+  free(elements);
+}
+END_TEST
+
+START_TEST(compactSparse)
+{
+  //widely spread values compact to an exactly sized array
+  enum { N = 5000 };
+  int elements[N];
+  unsigned seed = 3;
+  for (int i = 0; i < N; i++) {
+    seed = seed * 1103515245 + 12345;
+    elements[i] = (int)seed;
+  }
+  for (int b = 0; b < N_INT_SET_BACKENDS; b++) {
+    compactTest(b, elements, N, sizeof(Header) + N * sizeof(int));
+  }
+}
+END_TEST
+
+START_TEST(compactMapped)
+{
+  char path[64];
+  tempPath(path, sizeof(path), "compact");
+  void *set = newBackendIntSet(ARRAY_INT_SET);
+  addFileTestElements(set);
+  ck_assert_int_eq(writeIntSet(set, path), 0);
+  void *mapped = openIntSetMapped(path);
+  ck_assert_ptr_ne(mapped, NULL);
+  ck_assert_uint_gt(memoryUsageIntSet(mapped), sizeof(Header));
+  ck_assert_int_eq(compactIntSet(mapped), 0);
+  checkSameElements(mapped, set);
+  freeIntSet(mapped);
+  freeIntSet(set);
+  unlink(path);
+}
+END_TEST
+
+static Suite *
+memorySuite(void)
+{
+  Suite *suite = suite_create("memory");
+  TCase *tests = tcase_create("memory");
+  tcase_add_test(tests, memoryUsage);
+  tcase_add_test(tests, compactDense);
+  tcase_add_test(tests, compactSparse);
+  tcase_add_test(tests, compactMapped);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/***************************** Key-Set Tests ***************************/
+
+enum { N_RANDOM_KEYS = 50000 };
+
+/** Define test Name##Keys for the key-set variant Name: adds extremes,
+ *  duplicates and N_RANDOM_KEYS pseudo-random keys (enough to split
+ *  B+-tree nodes several levels deep), then checks lookup and that
+ *  iteration yields every key once in increasing order.
+ */
+#define KEY_SET_TEST(Name, name, Key, MIN, MAX)                         \
+START_TEST(name##Keys)                                                  \
+{                                                                       \
+  void *set = new##Name##Set();                                         \
+  ck_assert_ptr_eq(new##Name##SetIterator(set), NULL);                  \
+  ck_assert_int_eq(add##Name##Set(set, MAX), 1);                        \
+  ck_assert_int_eq(add##Name##Set(set, MIN), 2);                        \
+  ck_assert_int_eq(add##Name##Set(set, MAX), 2);                        \
+  ck_assert_int_eq(isIn##Name##Set(set, MIN), 1);                       \
+  ck_assert_int_eq(isIn##Name##Set(set, (Key)(MIN + 1)), 0);            \
+  Key *keys = malloc((N_RANDOM_KEYS + 2) * sizeof(Key));                \
+  uint64_t seed = 12345;                                                \
+  for (int i = 0; i < N_RANDOM_KEYS; i++) {                             \
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;      \
+    /* every 4th key repeats an earlier one */                          \
+    keys[i] = (i % 4 == 3) ? keys[i / 2] : (Key)seed;                   \
+  }                                                                     \
+  for (int i = 0; i < N_RANDOM_KEYS/2; i++) add##Name##Set(set, keys[i]); \
+  addMultiple##Name##Set(set, &keys[N_RANDOM_KEYS/2], N_RANDOM_KEYS/2); \
+  keys[N_RANDOM_KEYS] = MIN;                                            \
+  keys[N_RANDOM_KEYS + 1] = MAX;                                        \
+  int n = N_RANDOM_KEYS + 2;                                            \
+  for (int i = 0; i < n; i++) {                                         \
+    ck_assert_int_eq(isIn##Name##Set(set, keys[i]), 1);                 \
+  }                                                                     \
+  int nUnique = 0;                                                      \
+  Key prev = 0;                                                         \
+  for (const void *iter = new##Name##SetIterator(set); iter != NULL;    \
+       iter = step##Name##SetIterator(iter)) {                          \
+    Key key = name##SetIteratorElement(iter);                           \
+    ck_assert(nUnique == 0 || prev < key);                              \
+    prev = key;                                                         \
+    nUnique++;                                                          \
+  }                                                                     \
+  ck_assert_int_eq(nUnique, nElements##Name##Set(set));                 \
+  ck_assert_int_le(nUnique, n);                                         \
+  ck_assert_int_ge(nUnique, n - N_RANDOM_KEYS/4);                       \
+  const void *iter = new##Name##SetIterator(set);                       \
+  ck_assert(name##SetIteratorElement(iter) == MIN);                     \
+  free##Name##SetIterator(iter);                                        \
+  free(keys);                                                           \
+  free##Name##Set(set);                                                 \
+}                                                                       \
+END_TEST
+
+KEY_SET_TEST(Int32, int32, int32_t, INT32_MIN, INT32_MAX)
+KEY_SET_TEST(UInt32, uInt32, uint32_t, 0, UINT32_MAX)
+KEY_SET_TEST(Int64, int64, int64_t, INT64_MIN, INT64_MAX)
+KEY_SET_TEST(UInt64, uInt64, uint64_t, 0, UINT64_MAX)
+
+START_TEST(wideKeysNotTruncated)
+{
+  void *set = newInt64Set();
+  int64_t big = (int64_t)1 << 40;
+  addInt64Set(set, big);
+  addInt64Set(set, big + 1);
+  ck_assert_int_eq(nElementsInt64Set(set), 2);
+  ck_assert_int_eq(isInInt64Set(set, 0), 0);
+  ck_assert_int_eq(isInInt64Set(set, 1), 0);
+  freeInt64Set(set);
+}
+END_TEST
+
+static Suite *
+keySetSuite(void)
+{
+  Suite *suite = suite_create("keySets");
+  TCase *tests = tcase_create("keySets");
+  tcase_add_test(tests, int32Keys);
+  tcase_add_test(tests, uInt32Keys);
+  tcase_add_test(tests, int64Keys);
+  tcase_add_test(tests, uInt64Keys);
+  tcase_add_test(tests, wideKeysNotTruncated);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
+/************************ Sorted-Array Kernel Tests ********************/
+
+/** Fill v[n] with strictly increasing values whose gaps are 1..maxGap,
+ *  starting near start.
+ */
+static void
+makeSortedInts(int v[], int n, int start, int maxGap, unsigned *seed)
+{
+  int x = start;
+  for (int i = 0; i < n; i++) {
+    *seed = *seed * 1103515245 + 12345;
+    x += 1 + (*seed >> 16) % maxGap;
+    v[i] = x;
+  }
+}
+
+typedef int SortedKernel(const int a[], int nA, const int b[], int nB,
+                         int out[]);
+
+/** Check each of kernels[nKernels] against reference on inputs of
+ *  sizes nA and nB (with gaps chosen so that the inputs overlap
+ *  substantially), both into a separate output and, if isInPlace,
+ *  into a copy of a and into a copy of b.
+ */
+static void
+checkKernels(SortedKernel *reference, SortedKernel *kernels[], int nKernels,
+             int nA, int nB, int isInPlace)
+{
+  unsigned seed = nA * 31 + nB;
+  int *a = malloc(nA * sizeof(int) + 1);
+  int *b = malloc(nB * sizeof(int) + 1);
+  int *expected = malloc((nA + nB) * sizeof(int) + 1);
+  int *out = malloc((nA + nB) * sizeof(int) + 1);
+  int span = nA > nB ? nA : nB;
+  makeSortedInts(a, nA, -5, 1 + 4*span/(nA + 1), &seed);
+  makeSortedInts(b, nB, -5, 1 + 4*span/(nB + 1), &seed);
+  int nExpected = reference(a, nA, b, nB, expected);
+  for (int k = 0; k < nKernels; k++) {
+    int n = kernels[k](a, nA, b, nB, out);
+    ck_assert_int_eq(n, nExpected);
+    ck_assert_int_eq(memcmp(out, expected, n * sizeof(int)), 0);
+    if (isInPlace) {
+      memcpy(out, a, nA * sizeof(int));
+      n = kernels[k](out, nA, b, nB, out);
+      ck_assert_int_eq(n, nExpected);
+      ck_assert_int_eq(memcmp(out, expected, n * sizeof(int)), 0);
+      memcpy(out, b, nB * sizeof(int));
+      n = kernels[k](a, nA, out, nB, out);
+      ck_assert_int_eq(n, nExpected);
+      ck_assert_int_eq(memcmp(out, expected, n * sizeof(int)), 0);
+    }
+  }
+  free(a); free(b); free(expected); free(out);
+}
+
+/** Input sizes: equal, mildly and very unequal, and tiny */
+static const int KERNEL_SIZES[][2] = {
+  { 1000, 1000 }, { 1003, 997 }, { 300, 1000 }, { 5000, 20 },
+  { 20, 5000 }, { 7, 3 }, { 0, 10 }, { 10, 0 }, { 1, 1 },
+};
+
+START_TEST(intersectKernels)
+{
+  SortedKernel *kernels[] = {
+    intersectSortedInts, simdIntersectSortedInts, gallopIntersectSortedInts,
+  };
+  for (int i = 0; i < sizeof(KERNEL_SIZES)/sizeof(KERNEL_SIZES[0]); i++) {
+    checkKernels(mergeIntersectSortedInts, kernels, 3,
+                 KERNEL_SIZES[i][0], KERNEL_SIZES[i][1], 1);
+  }
+}
+END_TEST
+
+START_TEST(unionKernels)
+{
+  SortedKernel *kernels[] = { unionSortedInts, gallopUnionSortedInts };
+  for (int i = 0; i < sizeof(KERNEL_SIZES)/sizeof(KERNEL_SIZES[0]); i++) {
+    checkKernels(mergeUnionSortedInts, kernels, 2,
+                 KERNEL_SIZES[i][0], KERNEL_SIZES[i][1], 0);
+  }
+}
+END_TEST
+
+/** Reference difference: keep each element of a not found in b */
+static int
+naiveDifference(const int a[], int nA, const int b[], int nB, int out[])
+{
+  int k = 0;
+  for (int i = 0; i < nA; i++) {
+    int isInB = 0;
+    for (int j = 0; j < nB && b[j] <= a[i]; j++) isInB |= b[j] == a[i];
+    if (!isInB) out[k++] = a[i];
+  }
+  return k;
+}
+
+START_TEST(differenceKernel)
+{
+  SortedKernel *kernels[] = { differenceSortedInts };
+  for (int i = 0; i < sizeof(KERNEL_SIZES)/sizeof(KERNEL_SIZES[0]); i++) {
+    checkKernels(naiveDifference, kernels, 1,
+                 KERNEL_SIZES[i][0], KERNEL_SIZES[i][1], 0);
+  }
+}
+END_TEST
+
+static Suite *
+sortedKernelSuite(void)
+{
+  Suite *suite = suite_create("sortedKernels");
+  TCase *tests = tcase_create("kernels");
+  tcase_add_test(tests, intersectKernels);
+  tcase_add_test(tests, unionKernels);
+  tcase_add_test(tests, differenceKernel);
+  suite_add_tcase(suite, tests);
+  return suite;
+}
+
 /*************************** Main Test Function ************************/
 
 
@@ -623,6 +2316,20 @@ static SuiteMaker *makers[] = {
   snprintIntSetSuite,
   unionIntSetSuite,
   intersectionIntSetSuite,
+  arrayBackendSuite,
+  bitmapBackendSuite,
+  hashBackendSuite,
+  sortedKernelSuite,
+  newSetOpSuite,
+  manyOpSuite,
+  parallelSuite,
+  concurrentSuite,
+  persistentSuite,
+  fileSuite,
+  orderQuerySuite,
+  batchIteratorSuite,
+  memorySuite,
+  keySetSuite,
 };
 
 
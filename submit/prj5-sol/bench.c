@@ -0,0 +1,339 @@
+#define _POSIX_C_SOURCE 200809L  //for clock_gettime() under -std=c18
+
+#include "cache-sim.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Throughput benchmark for cache_sim_result().  Runs synthetic traces
+ *  through a set of cache geometries and replacement policies, timing
+ *  each combination over several repetitions.
+ */
+
+static void
+usage(const char *program, const char *msg)
+{
+  fprintf(stderr, "%susage: %s [-n N_ACCESSES] [-r N_REPS] [-S STRIDE] "
+          "[-s seed] [-o CSV_FILE] [s-E-b-m...]\n"
+          "  -n: # of accesses in each generated trace (default %d)\n"
+          "  -r: # of timed repetitions per configuration (default %d)\n"
+          "  -S: byte stride for the strided trace (default %d)\n"
+          "  -s: seed for trace generation (default 0)\n"
+          "  -o: write machine-readable CSV results to CSV_FILE\n"
+          "  s-E-b-m: cache geometries to benchmark (default: built-in list)\n",
+          msg, program, 1000000, 5, 4096);
+  exit(1);
+}
+
+/** Default geometries used when none are specified on the command line */
+static const char *GEOMETRIES[] = {
+  "6-1-6-32",   /** 4KB direct-mapped */
+  "6-8-6-32",   /** 32KB 8-way */
+  "10-8-6-48",  /** 512KB 8-way */
+  "12-16-6-48", /** 4MB 16-way */
+};
+
+typedef struct {
+  const char *name;
+  Replacement replacement;
+} ReplacementName;
+
+static ReplacementName REPLACEMENTS[] = {
+  { "lru", LRU_R },
+  { "mru", MRU_R },
+  { "rand", RANDOM_R },
+};
+
+/************************** Trace Generators ***************************/
+
+/** Simple xorshift64* generator so that traces do not depend on rand() */
+static unsigned long
+next_random(unsigned long *state)
+{
+  unsigned long x = *state;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DUL;
+}
+
+/** Return uniform double in [0, 1) */
+static double
+next_uniform(unsigned long *state)
+{
+  return (next_random(state) >> 11) * (1.0 / (1UL << 53));
+}
+
+/** Parameters shared by all trace generators */
+typedef struct {
+  unsigned long nAccesses;   /** # of addresses to generate */
+  unsigned nLineBits;        /** b of cache being benchmarked */
+  MemAddr addrMask;          /** mask for addresses within 2**m */
+  unsigned long stride;      /** byte stride for strided trace */
+  unsigned long nLines;      /** # of distinct lines in working set */
+  unsigned long seed;        /** generator seed */
+} TraceParams;
+
+typedef void TraceGenerator(const TraceParams *params, MemAddr trace[]);
+
+/** Consecutive bytes starting at address 0 */
+static void
+gen_sequential(const TraceParams *params, MemAddr trace[])
+{
+  for (unsigned long i = 0; i < params->nAccesses; i++) {
+    trace[i] = i & params->addrMask;
+  }
+}
+
+/** Fixed byte stride starting at address 0 */
+static void
+gen_strided(const TraceParams *params, MemAddr trace[])
+{
+  for (unsigned long i = 0; i < params->nAccesses; i++) {
+    trace[i] = (i * params->stride) & params->addrMask;
+  }
+}
+
+/** Uniformly random lines within the working set */
+static void
+gen_uniform(const TraceParams *params, MemAddr trace[])
+{
+  unsigned long state = params->seed | 1;
+  for (unsigned long i = 0; i < params->nAccesses; i++) {
+    MemAddr line = next_random(&state) % params->nLines;
+    trace[i] = (line << params->nLineBits) & params->addrMask;
+  }
+}
+
+/** Zipf-distributed (exponent 0.99) lines within the working set; lower
+ *  line numbers are the most popular.
+ */
+static void
+gen_zipf(const TraceParams *params, MemAddr trace[])
+{
+  const double ALPHA = 0.99;
+  unsigned long nLines = params->nLines;
+  double *cdf = malloc(nLines * sizeof(double));
+  if (!cdf) { perror("malloc"); exit(1); }
+  double sum = 0.0;
+  for (unsigned long k = 0; k < nLines; k++) {
+    sum += 1.0 / pow(k + 1, ALPHA);
+    cdf[k] = sum;
+  }
+  unsigned long state = params->seed | 1;
+  for (unsigned long i = 0; i < params->nAccesses; i++) {
+    double u = next_uniform(&state) * sum;
+    unsigned long lo = 0, hi = nLines - 1;
+    while (lo < hi) { //find first k with cdf[k] >= u
+      unsigned long mid = lo + (hi - lo)/2;
+      if (cdf[mid] < u) lo = mid + 1; else hi = mid;
+    }
+    trace[i] = (lo << params->nLineBits) & params->addrMask;
+  }
+  free(cdf);
+}
+
+/** Follow a single random cycle through all lines in the working set,
+ *  as a linked-list traversal would.
+ */
+static void
+gen_pointer_chase(const TraceParams *params, MemAddr trace[])
+{
+  unsigned long nLines = params->nLines;
+  unsigned long *next = malloc(nLines * sizeof(unsigned long));
+  if (!next) { perror("malloc"); exit(1); }
+  for (unsigned long k = 0; k < nLines; k++) next[k] = k;
+  unsigned long state = params->seed | 1;
+  for (unsigned long k = nLines - 1; k > 0; k--) { //Sattolo's algorithm
+    unsigned long j = next_random(&state) % k;
+    unsigned long t = next[k]; next[k] = next[j]; next[j] = t;
+  }
+  unsigned long line = 0;
+  for (unsigned long i = 0; i < params->nAccesses; i++) {
+    trace[i] = (line << params->nLineBits) & params->addrMask;
+    line = next[line];
+  }
+  free(next);
+}
+
+typedef struct {
+  const char *name;
+  TraceGenerator *generator;
+} TraceName;
+
+static TraceName TRACES[] = {
+  { "sequential", gen_sequential },
+  { "strided", gen_strided },
+  { "uniform", gen_uniform },
+  { "zipf", gen_zipf },
+  { "chase", gen_pointer_chase },
+};
+
+/***************************** Benchmarking ****************************/
+
+/** Parse s-E-b-m spec into *params.  Return false on error. */
+static bool
+parse_params(const char *spec, Replacement replacement, CacheParams *params)
+{
+  params->replacement = replacement;
+  params->nSectorBits = 0;
+  params->indexFunction = BITS_I;
+  int n;
+  if (sscanf(spec, "%u-%u-%u-%u%n", &params->nSetBits, &params->nLinesPerSet,
+             &params->nLineBits, &params->nMemAddrBits, &n) != 4) {
+    return false;
+  }
+  return spec[n] == '\0' && params->nLineBits >= 2 &&
+    params->nLinesPerSet > 0 &&
+    params->nLineBits + params->nSetBits < params->nMemAddrBits &&
+    params->nMemAddrBits <= 64;
+}
+
+static double
+elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+static int
+double_compare(const void *p1, const void *p2)
+{
+  double d1 = *(const double *)p1;
+  double d2 = *(const double *)p2;
+  return (d1 > d2) - (d1 < d2);
+}
+
+/** Return percentile pct of sorted[n] using nearest-rank */
+static double
+percentile(const double sorted[], int n, double pct)
+{
+  int rank = (int)(pct/100.0 * n + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > n) rank = n;
+  return sorted[rank - 1];
+}
+
+/** Time nReps runs of trace[nAccesses] through a fresh cache with
+ *  *params, storing ns/access for each run in nsPerAccess[] in sorted
+ *  order.  Returns hit count from the last repetition.
+ */
+static unsigned long
+time_trace(const CacheParams *params, const MemAddr trace[],
+           unsigned long nAccesses, int nReps, double nsPerAccess[])
+{
+  unsigned long nHits = 0;
+  for (int r = 0; r < nReps; r++) {
+    CacheSim *cache = new_cache_sim(params);
+    nHits = 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (unsigned long i = 0; i < nAccesses; i++) {
+      CacheResult result = cache_sim_result(cache, trace[i]);
+      nHits += result.status == CACHE_HIT;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free_cache_sim(cache);
+    nsPerAccess[r] = elapsed_ns(&t0, &t1) / nAccesses;
+  }
+  qsort(nsPerAccess, nReps, sizeof(double), double_compare);
+  return nHits;
+}
+
+int
+main(int argc, const char *argv[])
+{
+  const char *program = argv[0];
+  unsigned long nAccesses = 1000000;
+  int nReps = 5;
+  unsigned long stride = 4096;
+  unsigned long seed = 0;
+  const char *csvPath = NULL;
+  int i;
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    const char *opt = argv[i];
+    if (strlen(opt) != 2 || strchr("nrSso", opt[1]) == NULL) {
+      usage(program, "invalid option\n");
+    }
+    if (i >= argc - 1) usage(program, "option requires additional argument\n");
+    const char *arg = argv[++i];
+    if (opt[1] == 'o') {
+      csvPath = arg;
+      continue;
+    }
+    char *p;
+    long v = strtol(arg, &p, 10);
+    if (*p != '\0' || v < 0 || (v == 0 && opt[1] != 's')) {
+      usage(program, "option value must be a positive integer\n");
+    }
+    switch (opt[1]) {
+    case 'n': nAccesses = v; break;
+    case 'r': nReps = v; break;
+    case 'S': stride = v; break;
+    case 's': seed = v; break;
+    }
+  }
+  const char **specs = (i < argc) ? &argv[i] : GEOMETRIES;
+  int nSpecs = (i < argc)
+    ? argc - i : sizeof(GEOMETRIES)/sizeof(GEOMETRIES[0]);
+
+  FILE *csv = NULL;
+  if (csvPath) {
+    if (!(csv = fopen(csvPath, "w"))) { perror(csvPath); exit(1); }
+    fprintf(csv, "geometry,policy,trace,accesses,reps,hit_rate,"
+            "ns_min,ns_p50,ns_p90,ns_max,accesses_per_sec\n");
+  }
+  printf("%-12s %-5s %-10s %8s %8s %8s %8s %8s %14s\n",
+         "geometry", "pol", "trace", "hit%", "ns-min", "ns-p50", "ns-p90",
+         "ns-max", "accesses/sec");
+
+  MemAddr *trace = malloc(nAccesses * sizeof(MemAddr));
+  double *nsPerAccess = malloc(nReps * sizeof(double));
+  if (!trace || !nsPerAccess) { perror("malloc"); exit(1); }
+  for (int g = 0; g < nSpecs; g++) {
+    CacheParams params;
+    if (!parse_params(specs[g], LRU_R, &params)) {
+      fprintf(stderr, "invalid cache params \"%s\"\n", specs[g]);
+      exit(1);
+    }
+    //working set of 4x the # of lines in the cache
+    unsigned long nCacheLines = (1UL << params.nSetBits) * params.nLinesPerSet;
+    TraceParams traceParams = {
+      .nAccesses = nAccesses,
+      .nLineBits = params.nLineBits,
+      .addrMask = (params.nMemAddrBits >= 64)
+                  ? ~0UL : (1UL << params.nMemAddrBits) - 1,
+      .stride = stride,
+      .nLines = 4 * nCacheLines,
+      .seed = seed,
+    };
+    for (int t = 0; t < sizeof(TRACES)/sizeof(TRACES[0]); t++) {
+      TRACES[t].generator(&traceParams, trace);
+      for (int r = 0; r < sizeof(REPLACEMENTS)/sizeof(REPLACEMENTS[0]); r++) {
+        params.replacement = REPLACEMENTS[r].replacement;
+        srand(seed);
+        unsigned long nHits =
+          time_trace(&params, trace, nAccesses, nReps, nsPerAccess);
+        double hitRate = nHits * 100.0 / nAccesses;
+        double p50 = percentile(nsPerAccess, nReps, 50);
+        double p90 = percentile(nsPerAccess, nReps, 90);
+        double rate = 1e9 / p50;
+        printf("%-12s %-5s %-10s %8.2f %8.2f %8.2f %8.2f %8.2f %14.0f\n",
+               specs[g], REPLACEMENTS[r].name, TRACES[t].name, hitRate,
+               nsPerAccess[0], p50, p90, nsPerAccess[nReps - 1], rate);
+        if (csv) {
+          fprintf(csv, "%s,%s,%s,%lu,%d,%.4f,%.3f,%.3f,%.3f,%.3f,%.0f\n",
+                  specs[g], REPLACEMENTS[r].name, TRACES[t].name, nAccesses,
+                  nReps, hitRate, nsPerAccess[0], p50, p90,
+                  nsPerAccess[nReps - 1], rate);
+        }
+      }
+    }
+  }
+  free(trace);
+  free(nsPerAccess);
+  if (csv) fclose(csv);
+  return 0;
+}
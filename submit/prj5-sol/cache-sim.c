@@ -1,13 +1,22 @@
 #include "cache-sim.h"
 
 #include "memalloc.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <unistd.h>
-#endif
+
+/** Return largest prime <= n, or 1 if there is none */
+static unsigned
+largest_prime(unsigned n) {
+    for (unsigned p = n; p >= 2; p--) {
+        unsigned d;
+        for (d = 2; d * d <= p && p % d != 0; d++) {}
+        if (d * d > p) return p;
+    }
+    return 1;
+}
 
 /** Create and return a new cache-simulation structure for a
  *  cache for main memory withe the specified cache parameters params.
@@ -21,6 +30,9 @@ new_cache_sim(const CacheParams *params) {
     sim->nLineBits = params->nLineBits;
     sim->nMemAddrBits = params->nMemAddrBits;
     sim->replacement = params->replacement;
+    sim->nSectorBits = params->nSectorBits;
+    sim->indexFunction = params->indexFunction;
+    sim->primeModulus = largest_prime(1U << params->nSetBits);
 
     //cache malloc
     unsigned long** sets = mallocChk( (1 << params->nSetBits) * sizeof(unsigned long*));
@@ -44,17 +56,31 @@ new_cache_sim(const CacheParams *params) {
     }
 
     //Cache Age malloc
-    time_t** cacheAge = mallocChk((1 << params->nSetBits) * sizeof(time_t*));
+    unsigned long** cacheAge = mallocChk((1 << params->nSetBits) * sizeof(unsigned long*));
     for(int i=0; i < (1 << params->nSetBits); i++) {
-        cacheAge[i] = callocChk(1, params->nLinesPerSet * sizeof(time_t));
+        cacheAge[i] = callocChk(1, params->nLinesPerSet * sizeof(unsigned long));
     }
     sim->cacheAge = cacheAge;
+
+    //Sector valid masks: calloc() leaves all sectors invalid
+    unsigned long** sectorValid = mallocChk((1 << params->nSetBits) * sizeof(unsigned long*));
+    for(int i=0; i < (1 << params->nSetBits); i++) {
+        sectorValid[i] = callocChk(1, params->nLinesPerSet * sizeof(unsigned long));
+    }
+    sim->sectorValid = sectorValid;
     //Cache age init
     for(int i=0; i < (1 << sim->nSetBits); i++) {
         for (int j = 0; j < sim->nLinesPerSet; j++) {
             sim->cacheAge[i][j] = 0;
         }
     }
+    sim->clock = 0;
+    //seed from rand() so that srand() still controls RANDOM_R
+    sim->rngState = ((unsigned long)rand() << 1) | 1;
+    sim->nAccesses = 0;
+    for (int i = 0; i < CACHE_N_STATUS; i++) {
+        sim->stats[i] = 0;
+    }
 
     return sim;
 }
@@ -66,12 +92,28 @@ free_cache_sim(CacheSim *cache){
         free(cache->cache[i]);
         free(cache->cacheValid[i]);
         free(cache->cacheAge[i]);
+        free(cache->sectorValid[i]);
     }
     free(cache->cache);
     free(cache->cacheValid);
     free(cache->cacheAge);
+    free(cache->sectorValid);
     free(cache);
 }
+
+/** Step xorshift64 state and return next pseudo-random value.  Kept
+ *  in the cache rather than using rand() so it can be checkpointed.
+ */
+static unsigned long
+next_random(CacheSim *cache) {
+    unsigned long x = cache->rngState;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    cache->rngState = x;
+    return x;
+}
+
 MemAddr removeb_bits(MemAddr address, unsigned nLineBits) {
     MemAddr mask = ULONG_MAX;
     mask = mask << nLineBits;
@@ -79,11 +121,6 @@ MemAddr removeb_bits(MemAddr address, unsigned nLineBits) {
     return ret;
 }
 
-MemAddr getTagBits(MemAddr address, unsigned tagBitsSize, unsigned nMemAddrBits) {
-    MemAddr ret = address >> (nMemAddrBits - tagBitsSize);
-    return ret;
-}
-
 MemAddr getSetBits(MemAddr address, unsigned nSetBits, unsigned nMemAddrBits, unsigned tagBits) {
     MemAddr ret = address >> (nMemAddrBits - tagBits - nSetBits);
     MemAddr mask = 0;
@@ -91,76 +128,129 @@ MemAddr getSetBits(MemAddr address, unsigned nSetBits, unsigned nMemAddrBits, un
     ret = ret & mask;
     return ret;
 }
+
+/** Return mask with bit set for the sector of its line containing address */
+static unsigned long
+getSectorMask(MemAddr address, unsigned nSectorBits, unsigned nLineBits) {
+    MemAddr sector = (address >> (nLineBits - nSectorBits)) & ((1UL << nSectorBits) - 1);
+    return 1UL << sector;
+}
+/** Return all bits of x above the low nBits xor-folded into nBits */
+static MemAddr
+foldBits(MemAddr x, unsigned nBits) {
+    MemAddr fold = 0;
+    if (nBits == 0) return 0;
+    for (; x != 0; x = (nBits < 64) ? x >> nBits : 0) {
+        fold ^= x;
+    }
+    return fold & ((1UL << nBits) - 1);
+}
+
+/** Return set holding way of address for the set-index functions
+ *  other than BITS_I; set is the BITS_I set of address.
+ */
+static unsigned
+getHashedSet(const CacheSim *cache, MemAddr address, unsigned set, unsigned way) {
+    unsigned nSetBits = cache->nSetBits;
+    MemAddr line = (address & ((cache->nMemAddrBits < 64) ? (1UL << cache->nMemAddrBits) - 1 : ULONG_MAX))
+        >> cache->nLineBits;
+    MemAddr upper = (nSetBits < 64) ? line >> nSetBits : 0;
+    switch (cache->indexFunction) {
+    case XOR_I:
+        return set ^ foldBits(upper, nSetBits);
+    case PRIME_I:
+        return line % cache->primeModulus;
+    case SKEW_I: {
+        //Seznec-style: set bits xor'd with a per-way hash of the upper bits
+        MemAddr h = foldBits(upper, 32) * (0x9E3779B97F4A7C15UL * (2*way + 1));
+        return set ^ ((nSetBits == 0) ? 0 : h >> (64 - nSetBits));
+    }
+    default:
+        return set;
+    }
+}
+/** Return set in which way of the cache may hold address; set is the
+ *  set for every way when the index function is not skewed.
+ */
+static inline unsigned
+getWaySet(const CacheSim *cache, MemAddr address, unsigned set, unsigned way) {
+    return (cache->indexFunction == SKEW_I) ? getHashedSet(cache, address, set, way) : set;
+}
+
 //shift to right by b bits and then mask
-/** Return result for requesting addr from cache */
-CacheResult
-cache_sim_result(CacheSim *cache, MemAddr addr) {
+static CacheResult
+lookup_line(CacheSim *cache, MemAddr addr) {
     CacheResult result_hit = { CACHE_HIT, 0 };
     CacheResult result_miss_noReplace = { CACHE_MISS_WITHOUT_REPLACE, 0 };
     // cache replacement strategies
 
     unsigned tagBitsSize = cache->nMemAddrBits - (cache->nLineBits + cache->nSetBits);
     unsigned addressSet = getSetBits(addr, cache->nSetBits, cache->nMemAddrBits, tagBitsSize);
+    if (cache->indexFunction == XOR_I || cache->indexFunction == PRIME_I) {
+        addressSet = getHashedSet(cache, addr, addressSet, 0);
+    }
+    unsigned long sectorMask = getSectorMask(addr, cache->nSectorBits, cache->nLineBits);
+    //hashed sets do not determine the address bits above the set bits,
+    //so compare complete line addresses rather than just tags
+    MemAddr lineAddr = removeb_bits(addr, cache->nLineBits);
 
     //Hit - found in cache
         for(int j=0; j < cache->nLinesPerSet; j++) {
-            if ((getTagBits(cache->cache[addressSet][j], tagBitsSize, cache->nMemAddrBits) == getTagBits(addr, tagBitsSize, cache->nMemAddrBits)
-                && (cache->cacheValid[addressSet][j]))) {
-                    sleep(1);
-                    cache->cacheAge[addressSet][j] = time(NULL);
+            unsigned set = getWaySet(cache, addr, addressSet, j);
+            if (cache->cacheValid[set][j] && cache->cache[set][j] == lineAddr) {
+                    cache->cacheAge[set][j] = ++cache->clock;
+                    if (!(cache->sectorValid[set][j] & sectorMask)) {
+                        //line present but sector must be fetched
+                        cache->sectorValid[set][j] |= sectorMask;
+                        CacheResult result_sector_miss = { CACHE_SECTOR_MISS, 0 };
+                        return result_sector_miss;
+                    }
                     return result_hit;
             }
         }
         //cache hit fails - look for miss w/o replacement - populate free cache lines
         for(int j=0; j < cache->nLinesPerSet; j++) {
-            if(!cache->cacheValid[addressSet][j]){
-                cache->cacheValid[addressSet][j] = 1;
-                cache->cache[addressSet][j] = removeb_bits(addr, cache->nLineBits);
-                sleep(1);
-                cache->cacheAge[addressSet][j] = time(NULL);
+            unsigned set = getWaySet(cache, addr, addressSet, j);
+            if(!cache->cacheValid[set][j]){
+                cache->cacheValid[set][j] = 1;
+                cache->cache[set][j] = lineAddr;
+                cache->cacheAge[set][j] = ++cache->clock;
+                cache->sectorValid[set][j] = sectorMask;
                 return result_miss_noReplace;
             }
         }
         //if both hit and miss w/o replacement fail - use replacement strategy
+        int tempIndex = -1;
         if(cache->replacement == LRU_R) {
-            time_t min = LONG_MAX;
-            int tempIndex = -1;
+            unsigned long min = ULONG_MAX;
             for(int j=0; j < cache->nLinesPerSet; j++) {
-                if(cache->cacheAge[addressSet][j] < min) {
-                    min = cache->cacheAge[addressSet][j];
+                unsigned set = getWaySet(cache, addr, addressSet, j);
+                if(cache->cacheAge[set][j] < min) {
+                    min = cache->cacheAge[set][j];
                     tempIndex = j;
                 }
             }
-            MemAddr replacedAddress = cache->cache[addressSet][tempIndex];
-            cache->cache[addressSet][tempIndex] = removeb_bits(addr, cache->nLineBits);
-            sleep(1);
-            cache->cacheAge[addressSet][tempIndex] = time(NULL);
-            CacheResult result_miss_replace = { CACHE_MISS_WITH_REPLACE, replacedAddress};
-            return result_miss_replace;
         } else if(cache->replacement == MRU_R) {
-            time_t max = LONG_MIN;
-            int tempIndex = -1;
+            unsigned long max = 0;
             for(int j=0; j < cache->nLinesPerSet; j++) {
-                if(cache->cacheAge[addressSet][j] > max) {
-                    max = cache->cacheAge[addressSet][j];
+                unsigned set = getWaySet(cache, addr, addressSet, j);
+                if(cache->cacheAge[set][j] > max) {
+                    max = cache->cacheAge[set][j];
                     tempIndex = j;
                 }
             }
-            MemAddr replacedAddress = cache->cache[addressSet][tempIndex];
-            cache->cache[addressSet][tempIndex] = removeb_bits(addr, cache->nLineBits);
-            sleep(1);
-            cache->cacheAge[addressSet][tempIndex] = time(NULL);
-            CacheResult result_miss_replace = { CACHE_MISS_WITH_REPLACE, replacedAddress};
-            return result_miss_replace;
         } else if(cache->replacement == RANDOM_R) {
-            unsigned index = rand() % cache->nLinesPerSet;
-            MemAddr replacedAddress = cache->cache[addressSet][index];
-            cache->cache[addressSet][index] = removeb_bits(addr, cache->nLineBits);
-            //cache->cacheAge[addressSet][index] = time(NULL);
-            CacheResult result_miss_replace = { CACHE_MISS_WITH_REPLACE, replacedAddress};
-            return result_miss_replace;
+            tempIndex = next_random(cache) % cache->nLinesPerSet;
         }
-        
+        unsigned set = getWaySet(cache, addr, addressSet, tempIndex);
+        MemAddr replacedAddress = cache->cache[set][tempIndex];
+        cache->cache[set][tempIndex] = lineAddr;
+        //random replacement does not use ages
+        if (cache->replacement != RANDOM_R) cache->cacheAge[set][tempIndex] = ++cache->clock;
+        cache->sectorValid[set][tempIndex] = sectorMask;
+        CacheResult result_miss_replace = { CACHE_MISS_WITH_REPLACE, replacedAddress};
+        return result_miss_replace;
+
         //0xabcd - least signifcant b bits - 8 bits - cd
         //         s bit - b
         //         t bits - a
@@ -171,3 +261,163 @@ cache_sim_result(CacheSim *cache, MemAddr addr) {
         //0xbb10  - b=10, s=b, t=b
 
 }
+
+/** Return result for requesting addr from cache */
+CacheResult
+cache_sim_result(CacheSim *cache, MemAddr addr) {
+    CacheResult result = lookup_line(cache, addr);
+    cache->nAccesses++;
+    cache->stats[result.status]++;
+    return result;
+}
+
+/** Reset the per-status stats of cache to zero without changing its
+ *  contents; used to exclude warm-up accesses from the stats.
+ */
+void
+clear_cache_sim_stats(CacheSim *cache) {
+    for (int i = 0; i < CACHE_N_STATUS; i++) {
+        cache->stats[i] = 0;
+    }
+}
+
+/*************************** Checkpointing ****************************/
+
+/* Checkpoint layout (native byte order):
+ *   magic, version: uint32
+ *   s, E, b, m, replacement, nSectorBits, indexFunction: uint32
+ *   clock, rngState, nAccesses, stats[CACHE_N_STATUS]: uint64
+ *   for each set: valid mask of ceil(E/8) bytes followed by
+ *                 (tag, age, sector mask) uint64 triples for each
+ *                 valid line only.
+ */
+#define CHECKPOINT_MAGIC 0x4d495343u  /* "CSIM" */
+#define CHECKPOINT_VERSION 3u
+
+static int
+write_u32(FILE *f, uint32_t v) {
+    return fwrite(&v, sizeof(v), 1, f) == 1 ? 0 : -1;
+}
+
+static int
+write_u64(FILE *f, uint64_t v) {
+    return fwrite(&v, sizeof(v), 1, f) == 1 ? 0 : -1;
+}
+
+static int
+read_u32(FILE *f, uint32_t *v) {
+    return fread(v, sizeof(*v), 1, f) == 1 ? 0 : -1;
+}
+
+static int
+read_u64(FILE *f, uint64_t *v) {
+    return fread(v, sizeof(*v), 1, f) == 1 ? 0 : -1;
+}
+
+/** Save complete state of cache (parameters, lines, clock, random
+ *  state and stats) to a binary file at path.  Returns 0 on success,
+ *  < 0 on error with errno set.
+ */
+int
+save_cache_sim(const CacheSim *cache, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int err = 0;
+    err |= write_u32(f, CHECKPOINT_MAGIC);
+    err |= write_u32(f, CHECKPOINT_VERSION);
+    err |= write_u32(f, cache->nSetBits);
+    err |= write_u32(f, cache->nLinesPerSet);
+    err |= write_u32(f, cache->nLineBits);
+    err |= write_u32(f, cache->nMemAddrBits);
+    err |= write_u32(f, cache->replacement);
+    err |= write_u32(f, cache->nSectorBits);
+    err |= write_u32(f, cache->indexFunction);
+    err |= write_u64(f, cache->clock);
+    err |= write_u64(f, cache->rngState);
+    err |= write_u64(f, cache->nAccesses);
+    for (int i = 0; i < CACHE_N_STATUS; i++) {
+        err |= write_u64(f, cache->stats[i]);
+    }
+    unsigned nMaskBytes = (cache->nLinesPerSet + 7)/8;
+    unsigned char mask[nMaskBytes];
+    for (int i = 0; i < (1 << cache->nSetBits) && !err; i++) {
+        for (int k = 0; k < nMaskBytes; k++) mask[k] = 0;
+        for (int j = 0; j < cache->nLinesPerSet; j++) {
+            if (cache->cacheValid[i][j]) mask[j/8] |= 1 << (j%8);
+        }
+        if (fwrite(mask, 1, nMaskBytes, f) != nMaskBytes) err = -1;
+        for (int j = 0; j < cache->nLinesPerSet; j++) {
+            if (!cache->cacheValid[i][j]) continue;
+            err |= write_u64(f, cache->cache[i][j]);
+            err |= write_u64(f, cache->cacheAge[i][j]);
+            err |= write_u64(f, cache->sectorValid[i][j]);
+        }
+    }
+    if (fclose(f) != 0) err = -1;
+    return err ? -1 : 0;
+}
+
+/** Return a new cache-simulation structure restored from a file
+ *  previously written by save_cache_sim().  Returns NULL on error
+ *  with errno set (EINVAL if the file is not a valid checkpoint).
+ */
+CacheSim *
+load_cache_sim(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    uint32_t magic, version, fields[7];
+    int err = read_u32(f, &magic) | read_u32(f, &version);
+    for (int i = 0; i < 7 && !err; i++) err |= read_u32(f, &fields[i]);
+    //same limits as make_cache_sim() in main.c puts on s-E-b-m
+    if (err || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION ||
+        fields[0] > MAX_SET_BITS || fields[1] < 1 || fields[2] < 2 ||
+        fields[3] > MAX_MEM_ADDR_BITS || fields[2] >= fields[3] ||
+        fields[2] + fields[0] >= fields[3] ||
+        fields[4] > RANDOM_R || fields[5] > fields[2] ||
+        fields[5] > MAX_SECTOR_BITS || fields[6] > SKEW_I) {
+        fclose(f);
+        errno = EINVAL;
+        return NULL;
+    }
+    CacheParams params = {
+        .nSetBits = fields[0], .nLinesPerSet = fields[1],
+        .nLineBits = fields[2], .nMemAddrBits = fields[3],
+        .replacement = fields[4], .nSectorBits = fields[5],
+        .indexFunction = fields[6],
+    };
+    CacheSim *sim = new_cache_sim(&params);
+    unsigned nMaskBytes = (params.nLinesPerSet + 7)/8;
+    unsigned char *mask = malloc(nMaskBytes);
+    if (!sim || !mask) {
+        if (sim) free_cache_sim(sim);
+        free(mask);
+        fclose(f);
+        errno = ENOMEM;
+        return NULL;
+    }
+    uint64_t v;
+    err |= read_u64(f, &v); sim->clock = v;
+    err |= read_u64(f, &v); sim->rngState = v;
+    err |= read_u64(f, &v); sim->nAccesses = v;
+    for (int i = 0; i < CACHE_N_STATUS; i++) {
+        err |= read_u64(f, &v); sim->stats[i] = v;
+    }
+    for (int i = 0; i < (1 << sim->nSetBits) && !err; i++) {
+        if (fread(mask, 1, nMaskBytes, f) != nMaskBytes) err = -1;
+        for (int j = 0; j < sim->nLinesPerSet && !err; j++) {
+            if (!(mask[j/8] & (1 << (j%8)))) continue;
+            sim->cacheValid[i][j] = 1;
+            err |= read_u64(f, &v); sim->cache[i][j] = v;
+            err |= read_u64(f, &v); sim->cacheAge[i][j] = v;
+            err |= read_u64(f, &v); sim->sectorValid[i][j] = v;
+        }
+    }
+    free(mask);
+    fclose(f);
+    if (err) {
+        free_cache_sim(sim);
+        errno = EINVAL;
+        return NULL;
+    }
+    return sim;
+}
@@ -1,7 +1,6 @@
 #ifndef CACHE_SIM_
 #define CACHE_SIM_
 
-#include <time.h>
 #include <limits.h>
 
 /** Opaque implementation */
@@ -15,11 +14,30 @@ typedef enum {
   RANDOM_R       /** Random replacement */
 } Replacement;
 
+/** Function used to map an address to its set */
+typedef enum {
+  BITS_I,        /** plain s bits above the line offset */
+  XOR_I,         /** set bits xor'd with all higher address bits folded */
+  PRIME_I,       /** line number modulo largest prime <= # of sets */
+  SKEW_I         /** skewed-associative: different hash for each way */
+} IndexFunction;
+
 /** A primary memory address */
 typedef unsigned long MemAddr;
 
+/** Maximum nSectorBits: sector valid bits are kept in an unsigned long */
+#define MAX_SECTOR_BITS 6
+
+/** Maximum nSetBits: sets are indexed by an int */
+#define MAX_SET_BITS 30
+
+/** Maximum nMemAddrBits: addresses are kept in a MemAddr */
+#define MAX_MEM_ADDR_BITS 64
+
 /** Parameters which specify a cache.
- *  Must have nMemAddrBits > nLineBits >= 2.
+ *  Must have MAX_MEM_ADDR_BITS >= nMemAddrBits > nLineBits + nSetBits,
+ *  nLineBits >= 2, nLinesPerSet >= 1, nSetBits <= MAX_SET_BITS and
+ *  nSectorBits <= min(nLineBits, MAX_SECTOR_BITS).
  */
 typedef struct {
   unsigned nSetBits;       /** Slides notation: s; # of sets is 2**this */
@@ -28,6 +46,9 @@ typedef struct {
   unsigned nMemAddrBits;   /** Slides notation: m; # of bits in primary mem
                                addr; total primary addr space is 2**this */
   Replacement replacement; /** replacement strategy */
+  unsigned nSectorBits;    /** # of sectors/line is 2**this, each with its
+                               own valid bit; 0 for unsectored lines */
+  IndexFunction indexFunction; /** set-index function */
 } CacheParams;
 
 
@@ -44,6 +65,7 @@ typedef enum {
   CACHE_HIT,                  /** address found in cache */
   CACHE_MISS_WITHOUT_REPLACE, /** address not found, no line replaced */
   CACHE_MISS_WITH_REPLACE,    /** address not found in cache, line replaced */
+  CACHE_SECTOR_MISS,          /** line found but its sector was not valid */
   CACHE_N_STATUS              /** dummy value: # of status values possible */
 } CacheStatus;
 
@@ -60,12 +82,37 @@ struct CacheSimImpl {
     unsigned nMemAddrBits;   /** Slides notation: m; # of bits in primary mem
                                addr; total primary addr space is 2**this */
     Replacement replacement; /** replacement strategy */
+    unsigned nSectorBits;    /** # of sectors/line is 2**this */
+    IndexFunction indexFunction; /** set-index function */
+    unsigned primeModulus;   /** # of sets used by PRIME_I */
     MemAddr** cache;
     int** cacheValid;
-    time_t** cacheAge;
+    unsigned long** cacheAge; /** clock value at last access of each line */
+    unsigned long** sectorValid; /** valid bit for each sector of each line */
+    unsigned long clock;      /** logical clock; ticks on each line access */
+    unsigned long rngState;   /** state for RANDOM_R victim selection */
+    unsigned long nAccesses;  /** total # of addresses requested */
+    unsigned long stats[CACHE_N_STATUS]; /** # of results with each status */
 };
 
 /** Return result for requesting addr from cache */
 CacheResult cache_sim_result(CacheSim *cache, MemAddr addr);
 
+/** Reset the per-status stats of cache to zero without changing its
+ *  contents; used to exclude warm-up accesses from the stats.
+ */
+void clear_cache_sim_stats(CacheSim *cache);
+
+/** Save complete state of cache (parameters, lines, clock, random
+ *  state and stats) to a binary file at path.  Returns 0 on success,
+ *  < 0 on error with errno set.
+ */
+int save_cache_sim(const CacheSim *cache, const char *path);
+
+/** Return a new cache-simulation structure restored from a file
+ *  previously written by save_cache_sim().  Returns NULL on error
+ *  with errno set (EINVAL if the file is not a valid checkpoint).
+ */
+CacheSim *load_cache_sim(const char *path);
+
 #endif //ifndef CACHE_SIM_
@@ -1,5 +1,6 @@
 #include "cache-sim.h"
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,14 +9,29 @@
 static void
 usage(const char *program, const char *msg)
 {
-  fprintf(stderr, "%susage: %s [-r lru|mru|rand] [-s seed] [-v] s-E-b-m\n"
+  fprintf(stderr, "%susage: %s [-r lru|mru|rand] [-i bits|xor|prime|skew] "
+          "[-s seed] [-v] [-w N] [-S k] [-c CHECKPOINT [-n N]] s-E-b-m\n"
+          "       %s [-v] [-w N] [-c CHECKPOINT [-n N]] -l CHECKPOINT [-k]\n"
           "where s-E-b-m specified cache parameters:\n"
           "  s: # of bits in address used to specify set\n"
           "  E: # of cache lines per set\n"
           "  b: # of bits in address used to specify offset in cache line\n"
           "  m: total # of bits used to address primary memory\n"
-          "  must have all non-negative and 2 <= b and b + s < m\n",
-          msg, program);
+          "  must have all non-negative, 1 <= E, 2 <= b, b + s < m,\n"
+          "  s <= %d and m <= %d\n"
+          "  -i: set-index function (default bits)\n"
+          "  -S: divide each line into 2**k separately valid sectors\n"
+          "      (k <= b and k <= %d; default 0)\n"
+          "  -w: run first N addresses without reporting or counting them\n"
+          "  -c: save cache state to CHECKPOINT at end of input and, if -n\n"
+          "      is given, after every N addresses\n"
+          "  -l: start from cache state loaded from CHECKPOINT instead of\n"
+          "      an empty s-E-b-m cache; the checkpoint fixes replacement,\n"
+          "      set-index function, sectors and random state\n"
+          "  -k: with -l, skip the addresses already simulated by the\n"
+          "      loaded cache to resume an interrupted run of the same trace\n",
+          msg, program, program, MAX_SET_BITS, MAX_MEM_ADDR_BITS,
+          MAX_SECTOR_BITS);
     exit(1);
 }
 
@@ -30,6 +46,29 @@ static ReplacementName REPLACEMENTS[] = {
   { "rand", RANDOM_R },
 };
 
+typedef struct {
+  const char *name;
+  IndexFunction indexFunction;
+} IndexFunctionName;
+
+static IndexFunctionName INDEX_FUNCTIONS[] = {
+  { "bits", BITS_I },
+  { "xor", XOR_I },
+  { "prime", PRIME_I },
+  { "skew", SKEW_I },
+};
+
+/** Translate from name to IndexFunction enum.  Return < 0 on error */
+static int
+get_index_function(const char *name) {
+  for (int i = 0; i < sizeof(INDEX_FUNCTIONS)/sizeof(INDEX_FUNCTIONS[0]); i++) {
+    if (strcmp(name, INDEX_FUNCTIONS[i].name) == 0) {
+      return INDEX_FUNCTIONS[i].indexFunction;
+    }
+  }
+  return -1;
+}
+
 /** Translate from name to Replacement enum.  Return < 0 on error */
 static int
 get_replacement(const char *name) {
@@ -42,15 +81,16 @@ get_replacement(const char *name) {
 }
 
 /** Somewhat non-elegant allocation here to force new_cache_sim() to
- *  make copies of *params.  Sets *nMemAddrBitsP which is used for
- *  verbose formatting in do_cache_sim().  Returns NULL on error.
+ *  make copies of *params.  Returns NULL on error.
  */
 static CacheSim *
 make_cache_sim(const char *paramsSpec, Replacement replacement,
-               unsigned *nMemAddrBitsP)
+               IndexFunction indexFunction, unsigned nSectorBits)
 {
   CacheParams params;
   params.replacement = replacement;
+  params.indexFunction = indexFunction;
+  params.nSectorBits = nSectorBits;
   unsigned *fieldsP[] = {
     &params.nSetBits, &params.nLinesPerSet,
     &params.nLineBits, &params.nMemAddrBits,
@@ -64,17 +104,21 @@ make_cache_sim(const char *paramsSpec, Replacement replacement,
     if (v < 0 || ((i < 3) ? (*p != '-') : (*p != '\0'))) return NULL;
     *fieldsP[i] = v;
   }
-  *nMemAddrBitsP = params.nMemAddrBits;
   return (*p == '\0') && (i == 4) && (params.nLineBits >= 2) &&
-         (params.nLineBits + params.nSetBits < params.nMemAddrBits)
+         (params.nLinesPerSet >= 1) && (params.nSetBits <= MAX_SET_BITS) &&
+         (params.nMemAddrBits <= MAX_MEM_ADDR_BITS) &&
+         (params.nLineBits + params.nSetBits < params.nMemAddrBits) &&
+         (nSectorBits <= params.nLineBits)
          ? new_cache_sim(&params)
          : NULL;
 }
 
 static void
-out_cache_stats(unsigned long stats[], unsigned long nTotal, FILE *out)
+out_cache_stats(const unsigned long stats[], unsigned long nTotal,
+                bool isSectored, FILE *out)
 {
   for (int i = 0; i < CACHE_N_STATUS; i++) {
+    if (i == CACHE_SECTOR_MISS && !isSectored) continue;
     switch (i) {
     case CACHE_HIT:
       fprintf(out, "hits: ");
@@ -85,6 +129,9 @@ out_cache_stats(unsigned long stats[], unsigned long nTotal, FILE *out)
     case CACHE_MISS_WITH_REPLACE:
       fprintf(out, "misses with replace: ");
       break;
+    case CACHE_SECTOR_MISS:
+      fprintf(out, "sector misses: ");
+      break;
     }
     fprintf(out, "%lu/%lu (%.2f%%) hits\n", stats[i], nTotal,
           (nTotal == 0) ? 0 : stats[i] * 100.0/nTotal);
@@ -93,21 +140,57 @@ out_cache_stats(unsigned long stats[], unsigned long nTotal, FILE *out)
 
 //must be in sync with CACHE_STATUS enum
 static const char *STATUS_STRS[] = {
-  "hit", "miss-without-replace", "miss-with-replace"
+  "hit", "miss-without-replace", "miss-with-replace", "sector-miss"
 };
 
+/** Options controlling checkpointing of the simulation */
+typedef struct {
+  const char *path;          /** checkpoint file; NULL for none */
+  unsigned long interval;    /** checkpoint every this many addresses; 0
+                              *  for only at end of input */
+  unsigned long nSkip;       /** # of leading input addresses to skip */
+} Checkpoint;
+
+/** Save cache to checkpoint->path, writing a temporary file first so
+ *  that an interrupt never leaves a partial checkpoint behind.
+ */
 static void
-do_cache_sim(CacheSim *cache, bool isVerbose, unsigned nMemAddrBits,
-             FILE *in, FILE *out)
+do_checkpoint(const CacheSim *cache, const Checkpoint *checkpoint)
 {
-  unsigned long stats[] = { 0UL, 0UL, 0UL };
-  unsigned addrWidth = (nMemAddrBits + 3)/4;
+  char tmpPath[strlen(checkpoint->path) + 5];
+  sprintf(tmpPath, "%s.tmp", checkpoint->path);
+  if (save_cache_sim(cache, tmpPath) < 0 ||
+      rename(tmpPath, checkpoint->path) < 0) {
+    fprintf(stderr, "cannot write checkpoint %s: %s\n", checkpoint->path,
+            strerror(errno));
+    exit(1);
+  }
+}
+
+/** Simulate addresses read from in.  The first nWarmup addresses of
+ *  the input (counting any skipped when resuming) only warm up the
+ *  cache: they are neither reported nor counted in the stats.
+ */
+static void
+do_cache_sim(CacheSim *cache, bool isVerbose, unsigned long nWarmup,
+             const Checkpoint *checkpoint, FILE *in, FILE *out)
+{
+  unsigned addrWidth = (cache->nMemAddrBits + 3)/4;
+  unsigned long nRead = 0;
+  for (; nRead < checkpoint->nSkip; nRead++) {
+    MemAddr addr;
+    if (fscanf(in, "%lx", &addr) != 1) break;
+  }
   while (1) {
     MemAddr addr;
     if (fscanf(in, "%lx", &addr) != 1) break;
     CacheResult result = cache_sim_result(cache, addr);
-    stats[result.status]++;
-    if (isVerbose) {
+    if (++nRead == nWarmup) clear_cache_sim_stats(cache);
+    if (checkpoint->path && checkpoint->interval > 0 &&
+        cache->nAccesses % checkpoint->interval == 0) {
+      do_checkpoint(cache, checkpoint);
+    }
+    if (isVerbose && nRead > nWarmup) {
       fprintf(out, "%0*lx: %s", addrWidth, addr, STATUS_STRS[result.status]);
       if (result.status == CACHE_MISS_WITH_REPLACE) {
         fprintf(out, " %0*lx", addrWidth, result.replaceAddr);
@@ -115,11 +198,14 @@ do_cache_sim(CacheSim *cache, bool isVerbose, unsigned nMemAddrBits,
       fprintf(out, "\n");
     }
   } // while (1)
+  //a trace no longer than the warm-up counts nothing
+  if (nRead < nWarmup) clear_cache_sim_stats(cache);
+  if (checkpoint->path) do_checkpoint(cache, checkpoint);
   unsigned long nTotal = 0UL;
   for (int i = 0; i < CACHE_N_STATUS; i++) {
-    nTotal += stats[i];
+    nTotal += cache->stats[i];
   }
-  out_cache_stats(stats, nTotal, out);
+  out_cache_stats(cache->stats, nTotal, cache->nSectorBits > 0, out);
 }
 
 int
@@ -129,13 +215,21 @@ main(int argc, const char *argv[])
   if (argc <= 1) usage(program, "");
   bool isVerbose = false;
   int replacement = LRU_R;
+  int indexFunction = BITS_I;
   int seed = 0;
+  Checkpoint checkpoint = { NULL, 0, 0 };
+  const char *loadPath = NULL;
+  bool isSkip = false;
+  unsigned long nWarmup = 0;
+  unsigned nSectorBits = 0;
+  bool isCacheOption = false; //-r, -i, -s or -S given; not with -l
   int i;
   for (i = 1; i < argc && argv[i][0] == '-'; i++) {
     if (strcmp(argv[i], "-v") == 0) {
       isVerbose = true;
     }
     else if (strcmp(argv[i], "-r") == 0) {
+      isCacheOption = true;
       if (i >= argc - 1) {
         usage(program, "-r requires lru|mru|rand additional argument\n");
       }
@@ -144,7 +238,18 @@ main(int argc, const char *argv[])
         usage(program, "replacement must be lru|mru|rand\n");
       }
     }
+    else if (strcmp(argv[i], "-i") == 0) {
+      isCacheOption = true;
+      if (i >= argc - 1) {
+        usage(program, "-i requires bits|xor|prime|skew additional argument\n");
+      }
+      indexFunction = get_index_function(argv[++i]);
+      if (indexFunction < 0) {
+        usage(program, "index function must be bits|xor|prime|skew\n");
+      }
+    }
     else if (strcmp(argv[i], "-s") == 0) {
+      isCacheOption = true;
       if (i >= argc - 1) {
         usage(program, "-s requires seed additional argument\n");
       }
@@ -154,21 +259,90 @@ main(int argc, const char *argv[])
         usage(program, "seed must be a non-negative integer\n");
       }
     }
+    else if (strcmp(argv[i], "-w") == 0) {
+      if (i >= argc - 1) {
+        usage(program, "-w requires # of warm-up addresses\n");
+      }
+      char *p;
+      long n = strtol(argv[++i], &p, 10);
+      if (n < 0 || *p != '\0') {
+        usage(program, "# of warm-up addresses must be non-negative\n");
+      }
+      nWarmup = n;
+    }
+    else if (strcmp(argv[i], "-S") == 0) {
+      isCacheOption = true;
+      if (i >= argc - 1) {
+        usage(program, "-S requires # of sector bits\n");
+      }
+      char *p;
+      long k = strtol(argv[++i], &p, 10);
+      if (k < 0 || k > MAX_SECTOR_BITS || *p != '\0') {
+        usage(program, "invalid # of sector bits\n");
+      }
+      nSectorBits = k;
+    }
+    else if (strcmp(argv[i], "-c") == 0) {
+      if (i >= argc - 1) {
+        usage(program, "-c requires checkpoint file additional argument\n");
+      }
+      checkpoint.path = argv[++i];
+    }
+    else if (strcmp(argv[i], "-n") == 0) {
+      if (i >= argc - 1) {
+        usage(program, "-n requires interval additional argument\n");
+      }
+      char *p;
+      long interval = strtol(argv[++i], &p, 10);
+      if (interval <= 0 || *p != '\0') {
+        usage(program, "interval must be a positive integer\n");
+      }
+      checkpoint.interval = interval;
+    }
+    else if (strcmp(argv[i], "-l") == 0) {
+      if (i >= argc - 1) {
+        usage(program, "-l requires checkpoint file additional argument\n");
+      }
+      loadPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "-k") == 0) {
+      isSkip = true;
+    }
     else {
       usage(program, "invalid option\n");
     }
   }
-  if (i != argc - 1) {
-    usage(program, "cache spec s-E-b-m required\n");
+  if (checkpoint.interval > 0 && !checkpoint.path) {
+    usage(program, "-n requires -c\n");
+  }
+  if (isSkip && !loadPath) usage(program, "-k requires -l\n");
+  if (isCacheOption && loadPath) {
+    usage(program, "-r, -i, -s and -S not allowed with -l\n");
+  }
+  if (i != argc - (loadPath ? 0 : 1)) {
+    usage(program, loadPath
+          ? "cache spec s-E-b-m not allowed with -l\n"
+          : "cache spec s-E-b-m required\n");
   }
 
   srand(seed);
-  const char *paramsSpec = argv[i];
-
-  unsigned nMemAddrBits;
-  CacheSim *cacheSim = make_cache_sim(paramsSpec, replacement, &nMemAddrBits);
-  if (!cacheSim) usage(program, "invalid cache params\n");
-  do_cache_sim(cacheSim, isVerbose, nMemAddrBits, stdin, stdout);
+  CacheSim *cacheSim;
+  if (loadPath) {
+    cacheSim = load_cache_sim(loadPath);
+    if (!cacheSim) {
+      fprintf(stderr, "cannot load checkpoint %s: %s\n", loadPath,
+              strerror(errno));
+      exit(1);
+    }
+    if (isSkip) checkpoint.nSkip = cacheSim->nAccesses;
+  }
+  else {
+    const char *paramsSpec = argv[i];
+    cacheSim = make_cache_sim(paramsSpec, replacement, indexFunction,
+                              nSectorBits);
+    if (!cacheSim) usage(program, "invalid cache params\n");
+  }
+  do_cache_sim(cacheSim, isVerbose, nWarmup, &checkpoint, stdin, stdout);
   free_cache_sim(cacheSim);
   return 0;
 